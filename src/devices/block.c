@@ -3,7 +3,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* A block device. */
 struct block
@@ -27,8 +27,18 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 /* The block block assigned to each Pintos role. */
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
+/* Cache of block device descriptors. */
+static struct slab_cache block_cache;
+
 static struct block *list_elem_to_block (struct list_elem *);
 
+/* Initializes the block device layer. */
+void
+block_init (void) 
+{
+  slab_cache_init (&block_cache, "block", sizeof (struct block), 0, NULL);
+}
+
 /* Returns a human-readable name for the given block device
    TYPE. */
 const char *
@@ -188,7 +198,7 @@ block_register (const char *name, enum block_type type,
                 const char *extra_info, block_sector_t size,
                 const struct block_operations *ops, void *aux)
 {
-  struct block *block = malloc (sizeof *block);
+  struct block *block = slab_alloc (&block_cache);
   if (block == NULL)
     PANIC ("Failed to allocate memory for block device descriptor");
 
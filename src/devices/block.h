@@ -39,6 +39,7 @@ enum block_type
     BLOCK_CNT                    /* Number of Pintos block types. */
   };
 
+void block_init (void);
 const char *block_type_name (enum block_type);
 
 /* Finding block devices. */
@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -51,6 +48,22 @@ pit_configure_channel (int channel, int mode, int frequency)
   ASSERT (channel == 0 || channel == 2);
   ASSERT (mode == 2 || mode == 3);
 
+  count = pit_frequency_to_count (frequency);
+
+  /* Configure the PIT mode and load its counters. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the PIT counter value that yields FREQUENCY periods per
+   second, that is, the length of one period in PIT cycles.  A
+   result of 0 is interpreted by the PIT as 65536. */
+uint16_t
+pit_frequency_to_count (int frequency) 
+{
   /* Convert FREQUENCY to a PIT counter value.  The PIT has a
      clock that runs at PIT_HZ cycles per second.  We must
      translate FREQUENCY into a number of these cycles. */
@@ -60,7 +73,7 @@ pit_configure_channel (int channel, int mode, int frequency)
          16-bit counter.  Force it to 0, which the PIT treats as
          65536, the highest possible count.  This yields a 18.2
          Hz timer, approximately. */
-      count = 0;
+      return 0;
     }
   else if (frequency > PIT_HZ)
     {
@@ -69,15 +82,55 @@ pit_configure_channel (int channel, int mode, int frequency)
          is illegal in mode 2, so we force it to 2, which yields
          a 596.590 kHz timer, approximately.  (This timer rate is
          probably too fast to be useful anyhow.) */
-      count = 2;
+      return 2;
     }
   else
-    count = (PIT_HZ + frequency / 2) / frequency;
+    return (PIT_HZ + frequency / 2) / frequency;
+}
 
-  /* Configure the PIT mode and load its counters. */
-  old_level = intr_disable ();
-  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30 | (mode << 1));
-  outb (PIT_PORT_COUNTER (channel), count);
-  outb (PIT_PORT_COUNTER (channel), count >> 8);
-  intr_set_level (old_level);
+/* Starts channel 0 counting down from COUNT, which must be
+   between 1 and PIT_COUNT_MAX, in mode 0 ("interrupt on terminal
+   count").  The channel's output goes high, raising a single
+   timer interrupt, COUNT PIT cycles from now, and stays high
+   until the channel is reprogrammed.  Interrupts must be off. */
+void
+pit_start_countdown (unsigned count) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (count >= 1 && count <= PIT_COUNT_MAX);
+
+  outb (PIT_PORT_CONTROL, 0x30);
+  outb (PIT_PORT_COUNTER (0), count);
+  outb (PIT_PORT_COUNTER (0), count >> 8);
+}
+
+/* Returns the current value of channel 0's counter, that is, the
+   number of PIT cycles left in the current period (in mode 2) or
+   countdown (in mode 0).  Interrupts must be off. */
+unsigned
+pit_read_counter (void) 
+{
+  unsigned lo, hi;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Latch the counter, then read it LSB first. */
+  outb (PIT_PORT_CONTROL, 0x00);
+  lo = inb (PIT_PORT_COUNTER (0));
+  hi = inb (PIT_PORT_COUNTER (0));
+  return lo | (hi << 8);
+}
+
+/* Returns the state of channel 0's output pin, using the 8254
+   read-back command.  In mode 0, the output is high if and only
+   if the countdown has reached zero.  Interrupts must be off. */
+bool
+pit_read_output (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* Read-back command latching channel 0's status byte only.
+     Bit 7 of the status byte is the output pin. */
+  outb (PIT_PORT_CONTROL, 0xe2);
+  return (inb (PIT_PORT_COUNTER (0)) & 0x80) != 0;
 }
@@ -1,8 +1,20 @@
 #ifndef DEVICES_PIT_H
 #define DEVICES_PIT_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/* PIT cycles per second. */
+#define PIT_HZ 1193180
+
+/* Largest count that pit_start_countdown() accepts. */
+#define PIT_COUNT_MAX 0xffff
+
 void pit_configure_channel (int channel, int mode, int frequency);
+uint16_t pit_frequency_to_count (int frequency);
+
+void pit_start_countdown (unsigned count);
+unsigned pit_read_counter (void);
+bool pit_read_output (void);
 
 #endif /* devices/pit.h */
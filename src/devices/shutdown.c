@@ -4,7 +4,13 @@
 #include "devices/kbd.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
+#include "threads/fpu.h"
+#include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/kmem.h"
+#include "threads/lockstat.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
@@ -127,6 +133,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  fpu_print_stats ();
+  lockstat_print ();
+  intr_print_stats ();
+  palloc_print_stats ();
+  kmem_print_stats ();
+  slab_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
 #endif
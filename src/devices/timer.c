@@ -1,9 +1,11 @@
 #include "devices/timer.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "devices/tsc.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
@@ -17,8 +19,53 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Nanoseconds per timer tick. */
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* Number of timer ticks since OS booted.  timer_interrupt()
+   updates it under ticks_seqlock, so that timer_ticks() can read
+   all 64 bits consistently without disabling interrupts. */
 static int64_t ticks;
+static struct seqlock ticks_seqlock;
+
+/* Once the TSC is calibrated, timer_ns() returns ns_base plus
+   the time since the TSC read tsc_base. */
+static bool hires;
+static int64_t ns_base;
+static uint64_t tsc_base;
+
+/* Pending high-resolution timers, in order of increasing expiry
+   time.  Protected by disabling interrupts. */
+static struct list hrtimer_list;
+
+/* List of threads blocked in timer_sleep(), in order of
+   increasing wake-up tick.  Threads with equal wake-up ticks are
+   kept in the order they went to sleep.  Protected by disabling
+   interrupts, because timer_interrupt() removes elements. */
+static struct list sleep_list;
+
+/* If false (default), the timer interrupts every tick.
+   If true, the idle thread stops the periodic tick while the CPU
+   is idle, as described in timer_enter_idle().
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* How the PIT is currently programmed. */
+enum tick_mode
+  {
+    TICK_PERIODIC,      /* Interrupting every tick. */
+    TICK_IDLE,          /* Counting down to a later tick, for idle. */
+    TICK_REALIGN,       /* Counting down to the next tick boundary. */
+    TICK_HRTIMER        /* Counting down to a high-resolution timer. */
+  };
+static enum tick_mode tick_mode;
+
+static unsigned tick_cycles;    /* PIT cycles per tick. */
+static unsigned oneshot_first;  /* Cycles from start of countdown to the
+                                   first tick boundary. */
+static unsigned oneshot_cycles; /* Length of countdown. */
+static int64_t idle_tick_cnt;   /* TICK_IDLE: boundaries in countdown. */
+static int64_t skipped_ticks;   /* Ticks that passed without interrupt. */
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -29,12 +76,29 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
+static bool wakeup_less (const struct list_elem *, const struct list_elem *,
+                         void *aux);
+static void wake_sleepers (void);
+static void do_tick (void);
+static void advance_ticks (int64_t cnt);
+static bool hrtimer_arm (unsigned first);
+static void hrtimer_rearm (void);
+static void hrtimer_run (void);
+static void hrtimer_interrupt (void);
+static bool hrtimer_less (const struct list_elem *, const struct list_elem *,
+                          void *aux);
+static void wake_thread (struct hrtimer *);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
+  list_init (&sleep_list);
+  list_init (&hrtimer_list);
+  seqlock_init (&ticks_seqlock);
+  tick_cycles = pit_frequency_to_count (TIMER_FREQ);
+  tick_mode = TICK_PERIODIC;
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -64,15 +128,34 @@ timer_calibrate (void)
       loops_per_tick |= test_bit;
 
   printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+
+  /* Calibrate the TSC, which gives timer_ns() its resolution.
+     tsc_calibrate() returns just after a tick boundary, so the
+     two clocks agree at the switch-over. */
+  if (tsc_calibrate ()) 
+    {
+      enum intr_level old_level = intr_disable ();
+      ns_base = ticks * NS_PER_TICK;
+      tsc_base = tsc_read ();
+      hires = true;
+      intr_set_level (old_level);
+      printf ("TSC: %'"PRIu64" cycles/s.\n", tsc_frequency ());
+    }
 }
 
 /* Returns the number of timer ticks since the OS booted. */
 int64_t
 timer_ticks (void) 
 {
-  enum intr_level old_level = intr_disable ();
-  int64_t t = ticks;
-  intr_set_level (old_level);
+  unsigned seq;
+  int64_t t;
+
+  do 
+    {
+      seq = seqlock_read_begin (&ticks_seqlock);
+      t = ticks;
+    }
+  while (seqlock_read_retry (&ticks_seqlock, seq));
   return t;
 }
 
@@ -84,16 +167,41 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of nanoseconds since the OS booted.  The
+   result never decreases.  Once timer_calibrate() has calibrated
+   the TSC, it has a resolution of about a nanosecond; before
+   that, or if the CPU has no usable TSC, it advances only once
+   per timer tick. */
+int64_t
+timer_ns (void) 
+{
+  if (hires)
+    return ns_base + tsc_to_ns (tsc_read () - tsc_base);
+  else
+    return timer_ticks () * NS_PER_TICK;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
-   be turned on. */
+   be turned on.
+
+   The calling thread is blocked on sleep_list until
+   timer_interrupt() finds that its wake-up tick has arrived, so
+   a sleeping thread consumes no CPU time in the meantime. */
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
 
   ASSERT (intr_get_level () == INTR_ON);
-  while (timer_elapsed (start) < ticks) 
-    thread_yield ();
+  if (ticks <= 0)
+    return;
+
+  old_level = intr_disable ();
+  cur->wakeup_tick = timer_ticks () + ticks;
+  list_insert_ordered (&sleep_list, &cur->elem, wakeup_less, NULL);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -109,15 +217,36 @@ timer_msleep (int64_t ms)
 void
 timer_usleep (int64_t us) 
 {
-  real_time_sleep (us, 1000 * 1000);
+  timer_nsleep (us * 1000);
 }
 
 /* Sleeps for approximately NS nanoseconds.  Interrupts must be
-   turned on. */
+   turned on.
+
+   The calling thread blocks on a high-resolution timer, so it
+   wakes up shortly after NS nanoseconds instead of at the next
+   tick boundary and does not busy-wait for short sleeps.
+   Without a usable TSC, falls back to tick-based sleeping. */
 void
 timer_nsleep (int64_t ns) 
 {
-  real_time_sleep (ns, 1000 * 1000 * 1000);
+  struct hrtimer t;
+  enum intr_level old_level;
+
+  ASSERT (intr_get_level () == INTR_ON);
+  if (!hires) 
+    {
+      real_time_sleep (ns, 1000 * 1000 * 1000);
+      return;
+    }
+  if (ns <= 0)
+    return;
+
+  hrtimer_init (&t, wake_thread, thread_current ());
+  old_level = intr_disable ();
+  hrtimer_start (&t, timer_ns () + ns);
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Busy-waits for approximately MS milliseconds.  Interrupts need
@@ -159,21 +288,374 @@ timer_ndelay (int64_t ns)
   real_time_delay (ns, 1000 * 1000 * 1000);
 }
 
+/* Initializes T as a high-resolution timer that calls FUNC,
+   which may use AUX, when it expires. */
+void
+hrtimer_init (struct hrtimer *t, hrtimer_func *func, void *aux) 
+{
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  t->func = func;
+  t->aux = aux;
+  t->pending = false;
+}
+
+/* Starts T so that its function is called, in an interrupt
+   handler, as soon as possible after timer_ns() reaches EXPIRES.
+   T must not already be pending.  May be called from an
+   interrupt handler.
+
+   If T becomes the earliest pending timer and expires before the
+   next tick boundary, the PIT is switched to a one-shot countdown
+   that ends at that time, whatever it was counting down to, and
+   periodic ticks resume afterward. */
+void
+hrtimer_start (struct hrtimer *t, int64_t expires) 
+{
+  enum intr_level old_level;
+
+  ASSERT (!t->pending);
+
+  old_level = intr_disable ();
+  t->expires = expires;
+  t->pending = true;
+  list_insert_ordered (&hrtimer_list, &t->elem, hrtimer_less, NULL);
+  if (list_front (&hrtimer_list) == &t->elem)
+    hrtimer_rearm ();
+  intr_set_level (old_level);
+}
+
+/* Stops T if it is pending.  Returns true if T was pending,
+   false if it had already expired or was never started. */
+bool
+hrtimer_cancel (struct hrtimer *t) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool pending = t->pending;
+
+  if (pending) 
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+    }
+  intr_set_level (old_level);
+  return pending;
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
 {
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+  if (timer_tickless)
+    printf ("Timer: %"PRId64" ticks passed without an interrupt\n",
+            skipped_ticks);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  If tickless idle is enabled, replaces the
+   periodic tick by a single countdown that ends at the tick on
+   which the first sleeping thread must wake up, or as close to
+   it as the PIT's 16-bit counter allows, so that the idle CPU is
+   not interrupted just to count ticks.
+
+   Tick boundaries keep their phase: the countdown is set to
+   expire exactly at a boundary, and the ticks it skipped are
+   accounted for by timer_irq_enter() at the next interrupt. */
+void
+timer_enter_idle (void) 
+{
+  int64_t cnt, max_cnt;
+  unsigned first;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || tick_mode != TICK_PERIODIC || tick_cycles == 0)
+    return;
+
+  /* Number of tick boundaries we would like to sleep through. */
+  if (list_empty (&sleep_list))
+    cnt = INT64_MAX;
+  else
+    cnt = list_entry (list_front (&sleep_list),
+                      struct thread, elem)->wakeup_tick - ticks;
+
+  /* Wake up at the last boundary before the first
+     high-resolution timer expires. */
+  if (!list_empty (&hrtimer_list)) 
+    {
+      struct hrtimer *t = list_entry (list_front (&hrtimer_list),
+                                      struct hrtimer, elem);
+      int64_t hr_cnt = (t->expires - timer_ns ()) / NS_PER_TICK;
+      if (hr_cnt < cnt)
+        cnt = hr_cnt;
+    }
+
+  /* Cycles until the next boundary, then whole ticks after it. */
+  first = pit_read_counter ();
+  if (first == 0 || first > tick_cycles)
+    return;
+  max_cnt = (PIT_COUNT_MAX - first) / tick_cycles + 1;
+  if (cnt > max_cnt)
+    cnt = max_cnt;
+  if (cnt < 2)
+    return;
+
+  oneshot_first = first;
+  idle_tick_cnt = cnt;
+  oneshot_cycles = first + (cnt - 1) * tick_cycles;
+  pit_start_countdown (oneshot_cycles);
+  tick_mode = TICK_IDLE;
+}
+
+/* Called by the interrupt handler on entry to every external
+   interrupt.  If the CPU was idle with the periodic tick
+   stopped, counts the ticks that passed meanwhile and arranges
+   for periodic ticks to resume at the proper phase. */
+void
+timer_irq_enter (void) 
+{
+  unsigned left, elapsed;
+  int64_t crossed;
+
+  ASSERT (intr_context ());
+
+  /* A TICK_HRTIMER countdown is handled by timer_interrupt(). */
+  if (tick_mode == TICK_PERIODIC || tick_mode == TICK_HRTIMER)
+    return;
+
+  if (tick_mode == TICK_REALIGN) 
+    {
+      /* Once we are back on a tick boundary, resume periodic
+         ticks.  The boundary's own interrupt, this one or one
+         still pending, counts the tick. */
+      if (pit_read_output ()) 
+        {
+          pit_configure_channel (0, 2, TIMER_FREQ);
+          tick_mode = TICK_PERIODIC;
+        }
+      return;
+    }
+
+  left = pit_read_counter ();
+  if (pit_read_output () || left == 0 || left > oneshot_cycles)
+    {
+      /* The countdown expired exactly on a tick boundary.  Its
+         interrupt, either this one or one still pending, counts
+         as the last tick; account for the rest here. */
+      advance_ticks (idle_tick_cnt - 1);
+      pit_configure_channel (0, 2, TIMER_FREQ);
+      tick_mode = TICK_PERIODIC;
+      return;
+    }
+
+  /* Another interrupt woke us up early.  Account for the
+     boundaries already crossed and count down to the next one,
+     where periodic ticks will resume. */
+  elapsed = oneshot_cycles - left;
+  crossed = (elapsed < oneshot_first ? 0
+             : (elapsed - oneshot_first) / tick_cycles + 1);
+  advance_ticks (crossed);
+  pit_start_countdown (oneshot_first + crossed * tick_cycles - elapsed);
+  tick_mode = TICK_REALIGN;
 }
-
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
+  if (tick_mode == TICK_HRTIMER)
+    hrtimer_interrupt ();
+  else 
+    {
+      do_tick ();
+      hrtimer_run ();
+      if (tick_mode == TICK_PERIODIC)
+        hrtimer_arm (pit_read_counter ());
+    }
+}
+
+/* Advances the time by one tick. */
+static void
+do_tick (void) 
+{
+  enum intr_level old_level = seqlock_write_begin (&ticks_seqlock);
   ticks++;
+  seqlock_write_end (&ticks_seqlock, old_level);
+
+  wake_sleepers ();
   thread_tick ();
 }
 
+/* Accounts for CNT ticks that passed without a timer interrupt
+   while the idle thread was running. */
+static void
+advance_ticks (int64_t cnt) 
+{
+  skipped_ticks += cnt;
+  for (; cnt > 0; cnt--) 
+    do_tick ();
+}
+
+/* If the earliest pending high-resolution timer expires before
+   the next tick boundary, which is FIRST PIT cycles away,
+   switches the PIT to a one-shot countdown that ends when the
+   timer expires and returns true.  Otherwise, returns false
+   without touching the PIT. */
+static bool
+hrtimer_arm (unsigned first) 
+{
+  struct hrtimer *t;
+  int64_t delta;
+  unsigned cycles;
+
+  if (!hires || list_empty (&hrtimer_list)
+      || first == 0 || first > tick_cycles)
+    return false;
+
+  t = list_entry (list_front (&hrtimer_list), struct hrtimer, elem);
+  delta = t->expires - timer_ns ();
+  if (delta >= NS_PER_TICK)
+    return false;
+  cycles = delta > 0 ? DIV_ROUND_UP (delta * PIT_HZ, 1000000000) : 1;
+  if (cycles >= first)
+    return false;
+
+  oneshot_first = first;
+  oneshot_cycles = cycles;
+  pit_start_countdown (cycles);
+  tick_mode = TICK_HRTIMER;
+  return true;
+}
+
+/* Called when a new high-resolution timer has become the
+   earliest pending one, to count down to it if it expires before
+   whatever the PIT is now counting down to. */
+static void
+hrtimer_rearm (void) 
+{
+  unsigned elapsed;
+
+  switch (tick_mode) 
+    {
+    case TICK_PERIODIC:
+      hrtimer_arm (pit_read_counter ());
+      break;
+
+    case TICK_HRTIMER:
+      /* Count down to the new timer instead of the old one,
+         keeping track of the next tick boundary.  If the old
+         countdown has already ended, its interrupt is pending
+         and will arm the new timer. */
+      if (!pit_read_output ()) 
+        {
+          elapsed = (oneshot_cycles - pit_read_counter ()) & PIT_COUNT_MAX;
+          if (elapsed < oneshot_first)
+            hrtimer_arm (oneshot_first - elapsed);
+        }
+      break;
+
+    case TICK_REALIGN:
+      /* The countdown ends at the next tick boundary. */
+      if (!pit_read_output ())
+        hrtimer_arm (pit_read_counter ());
+      break;
+
+    case TICK_IDLE:
+      /* Only the idle thread runs in this mode, with interrupts
+         off, and the next interrupt ends it. */
+      break;
+    }
+}
+
+/* Calls the function of each high-resolution timer that has
+   expired. */
+static void
+hrtimer_run (void) 
+{
+  int64_t now = timer_ns ();
+
+  while (!list_empty (&hrtimer_list)) 
+    {
+      struct hrtimer *t = list_entry (list_front (&hrtimer_list),
+                                      struct hrtimer, elem);
+      if (t->expires > now)
+        break;
+      list_pop_front (&hrtimer_list);
+      t->pending = false;
+      t->func (t);
+    }
+}
+
+/* Handles the end of a countdown started by hrtimer_arm().
+   Counts any tick boundary passed meanwhile, runs the expired
+   timers, and then counts down to either the next timer or the
+   next tick boundary. */
+static void
+hrtimer_interrupt (void) 
+{
+  /* In mode 0 the counter keeps counting down, and wraps
+     around, after the countdown ends. */
+  unsigned elapsed = (oneshot_cycles - pit_read_counter ()) & PIT_COUNT_MAX;
+  int first = (int) oneshot_first - (int) elapsed;
+
+  for (; first <= 0; first += tick_cycles)
+    do_tick ();
+  hrtimer_run ();
+  if (!hrtimer_arm (first)) 
+    {
+      pit_start_countdown (first);
+      tick_mode = TICK_REALIGN;
+    }
+}
+
+/* Returns true if high-resolution timer A expires strictly
+   before B. */
+static bool
+hrtimer_less (const struct list_elem *a, const struct list_elem *b,
+              void *aux UNUSED) 
+{
+  return (list_entry (a, struct hrtimer, elem)->expires
+          < list_entry (b, struct hrtimer, elem)->expires);
+}
+
+/* High-resolution timer function for timer_nsleep(): wakes up
+   the sleeping thread. */
+static void
+wake_thread (struct hrtimer *t) 
+{
+  thread_unblock (t->aux);
+}
+
+/* Unblocks every thread in sleep_list whose wake-up tick has
+   arrived.  Because sleep_list is sorted, this stops at the
+   first thread that must keep sleeping, so the cost is
+   proportional to the number of threads woken. */
+static void
+wake_sleepers (void) 
+{
+  while (!list_empty (&sleep_list)) 
+    {
+      struct thread *t = list_entry (list_front (&sleep_list),
+                                     struct thread, elem);
+      if (t->wakeup_tick > ticks)
+        break;
+      list_pop_front (&sleep_list);
+      thread_unblock (t);
+    }
+}
+
+/* Returns true if the thread owning A wakes up strictly before
+   the thread owning B. */
+static bool
+wakeup_less (const struct list_elem *a, const struct list_elem *b,
+             void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->wakeup_tick
+          < list_entry (b, struct thread, elem)->wakeup_tick);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
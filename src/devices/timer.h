@@ -1,17 +1,23 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Stop the periodic tick while idle?  See timer_enter_idle(). */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
+int64_t timer_ns (void);
 
 /* Sleep and yield the CPU to other threads. */
 void timer_sleep (int64_t ticks);
@@ -24,6 +30,26 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* High-resolution one-shot timer. */
+struct hrtimer;
+typedef void hrtimer_func (struct hrtimer *);
+struct hrtimer 
+  {
+    struct list_elem elem;      /* List element. */
+    int64_t expires;            /* Expiry time, as per timer_ns(). */
+    hrtimer_func *func;         /* Called from interrupt on expiry. */
+    void *aux;                  /* For use by FUNC. */
+    bool pending;               /* Started and not yet expired? */
+  };
+
+void hrtimer_init (struct hrtimer *, hrtimer_func *, void *aux);
+void hrtimer_start (struct hrtimer *, int64_t expires);
+bool hrtimer_cancel (struct hrtimer *);
+
 void timer_print_stats (void);
 
+/* Tickless idle support. */
+void timer_enter_idle (void);
+void timer_irq_enter (void);
+
 #endif /* devices/timer.h */
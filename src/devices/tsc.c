@@ -0,0 +1,90 @@
+#include "devices/tsc.h"
+#include <debug.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+
+/* The time-stamp counter (TSC) counts CPU cycles at a constant
+   rate.  We measure that rate against the timer tick once at
+   boot, which lets timer_ns() interpolate between ticks.  See
+   [IA32-v3a] 18.9 "Time-Stamp Counter". */
+
+/* Number of timer ticks over which to measure the TSC. */
+#define CALIBRATION_TICKS 10
+
+/* TSC cycles are converted to nanoseconds as
+   cycles * tsc_mult / 2**TSC_SHIFT. */
+#define TSC_SHIFT 24
+
+static uint64_t tsc_hz;         /* TSC frequency, 0 if unusable. */
+static uint32_t tsc_mult;       /* Nanoseconds per cycle, scaled. */
+
+static bool tsc_present (void);
+
+/* Measures the frequency of the TSC against the timer tick.
+   Returns true if successful, false if the CPU has no TSC or its
+   TSC is too slow to be useful.  Interrupts must be turned on.
+   Takes about CALIBRATION_TICKS timer ticks. */
+bool
+tsc_calibrate (void) 
+{
+  uint64_t begin, end, mult;
+  int64_t start;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  if (!tsc_present ())
+    return false;
+
+  /* Wait for a tick boundary, then count cycles over whole
+     ticks. */
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    continue;
+  begin = tsc_read ();
+  start = timer_ticks ();
+  while (timer_elapsed (start) < CALIBRATION_TICKS)
+    continue;
+  end = tsc_read ();
+
+  tsc_hz = (end - begin) * TIMER_FREQ / CALIBRATION_TICKS;
+  mult = tsc_hz != 0 ? (1000000000ULL << TSC_SHIFT) / tsc_hz : 0;
+  if (mult == 0 || mult > UINT32_MAX) 
+    {
+      tsc_hz = 0;
+      return false;
+    }
+  tsc_mult = mult;
+  return true;
+}
+
+/* Returns the TSC frequency in Hz, or 0 if tsc_calibrate() has
+   not succeeded. */
+uint64_t
+tsc_frequency (void) 
+{
+  return tsc_hz;
+}
+
+/* Converts CYCLES TSC cycles to nanoseconds.  The 96-bit product
+   is formed from two 64-bit multiplications, so the conversion
+   does not overflow for any realistic uptime. */
+int64_t
+tsc_to_ns (uint64_t cycles) 
+{
+  uint64_t hi = cycles >> 32;
+  uint64_t lo = cycles & 0xffffffff;
+
+  return (((hi * tsc_mult) << (32 - TSC_SHIFT))
+          + ((lo * tsc_mult) >> TSC_SHIFT));
+}
+
+/* Returns true if CPUID reports a time-stamp counter.  See
+   [IA32-v2a] "CPUID". */
+static bool
+tsc_present (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  return (edx & (1u << 4)) != 0;
+}
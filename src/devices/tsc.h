@@ -0,0 +1,21 @@
+#ifndef DEVICES_TSC_H
+#define DEVICES_TSC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Returns the current value of the CPU's time-stamp counter.
+   See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+tsc_read (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+bool tsc_calibrate (void);
+uint64_t tsc_frequency (void);
+int64_t tsc_to_ns (uint64_t cycles);
+
+#endif /* devices/tsc.h */
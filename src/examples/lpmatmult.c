@@ -0,0 +1,97 @@
+/* lpmatmult.c
+
+   Matrix multiplication that walks down the columns of a
+   DIM x DIM matrix, touching a different page on every step, so
+   that its speed depends on how many TLB misses it takes.
+
+   Multiplies ROWS rows of A by B twice: once with B in the BSS,
+   mapped with 4 kB pages, and once with B in a region obtained
+   from map_large(), mapped with 4 MB pages if the kernel and CPU
+   support them.  Prints the time taken by each in CPU cycles,
+   and exits with status 0 if both products agree. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Each row of B is 4 kB, so each element of a column of B is on
+   a page of its own. */
+#define DIM 1024
+
+/* Rows of the product to compute. */
+#define ROWS 8
+
+/* Where to map the large-page copy of B.  Must be a multiple of
+   LARGE_PAGE_SIZE, away from the program's code and data. */
+#define LARGE_BASE ((void *) 0x10000000)
+
+typedef int matrix[DIM][DIM];
+
+static int A[ROWS][DIM];
+static int C[ROWS][DIM];
+static matrix small_B;
+
+static uint64_t multiply (matrix *B);
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+int
+main (void) 
+{
+  matrix *large_B = LARGE_BASE;
+  uint64_t small_cycles, large_cycles;
+  int sum_small, sum_large;
+  int i, j;
+
+  if (!map_large (large_B, sizeof *large_B)) 
+    {
+      printf ("lpmatmult: map_large failed\n");
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < DIM; i++)
+    for (j = 0; j < DIM; j++) 
+      {
+        if (i < ROWS)
+          A[i][j] = i + j;
+        small_B[i][j] = (*large_B)[i][j] = i - j;
+      }
+
+  /* Warm up, then time each copy of B. */
+  multiply (&small_B);
+  small_cycles = multiply (&small_B);
+  sum_small = C[ROWS - 1][DIM - 1];
+  large_cycles = multiply (large_B);
+  sum_large = C[ROWS - 1][DIM - 1];
+
+  printf ("lpmatmult: 4 kB pages: %llu cycles\n", small_cycles);
+  printf ("lpmatmult: large pages: %llu cycles\n", large_cycles);
+  if (large_cycles != 0)
+    printf ("lpmatmult: speedup: %llu%%\n",
+            small_cycles * 100 / large_cycles);
+  return sum_small == sum_large ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Computes ROWS rows of the product of A and *B into C and
+   returns the number of cycles taken. */
+static uint64_t
+multiply (matrix *B) 
+{
+  uint64_t start = rdtsc ();
+  int i, j, k;
+
+  memset (C, 0, sizeof C);
+  for (i = 0; i < ROWS; i++)
+    for (j = 0; j < DIM; j++)
+      for (k = 0; k < DIM; k++)
+        C[i][j] += A[i][k] * (*B)[k][j];
+  return rdtsc () - start;
+}
@@ -0,0 +1,71 @@
+/* pcount.c
+
+   Has several user threads increment a shared counter under a
+   mutex, while the main thread waits on a condition variable for
+   all of them to finish, and checks the total.
+
+   Exercises the futex-based mutexes and condition variables in
+   lib/user/synch.h. */
+#include <stdio.h>
+#include <synch.h>
+#include <syscall.h>
+
+/* Number of threads to count with. */
+#define THREAD_CNT 4
+
+/* Increments per thread. */
+#define ITERATIONS 10000
+
+static struct mutex mutex;
+static struct condvar all_done;
+static int counter;
+static int done_cnt;
+
+/* Increments the counter ITERATIONS times, then reports that it
+   is done. */
+static void
+count (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      mutex_lock (&mutex);
+      counter++;
+      mutex_unlock (&mutex);
+    }
+
+  mutex_lock (&mutex);
+  done_cnt++;
+  condvar_signal (&all_done);
+  mutex_unlock (&mutex);
+}
+
+int
+main (void)
+{
+  int i;
+
+  mutex_init (&mutex);
+  condvar_init (&all_done);
+  for (i = 0; i < THREAD_CNT; i++)
+    if (uthread_create (count, NULL) == UTID_ERROR)
+      {
+        printf ("pcount: uthread_create failed\n");
+        return EXIT_FAILURE;
+      }
+
+  mutex_lock (&mutex);
+  while (done_cnt < THREAD_CNT)
+    condvar_wait (&all_done, &mutex);
+  mutex_unlock (&mutex);
+
+  if (counter != THREAD_CNT * ITERATIONS)
+    {
+      printf ("pcount: counted %d, expected %d\n",
+              counter, THREAD_CNT * ITERATIONS);
+      return EXIT_FAILURE;
+    }
+  printf ("pcount: %d threads counted to %d\n", THREAD_CNT, counter);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+/* psort.c
+
+   Sorts an array of integers with several user threads, each
+   sorting its own part of the array, and then merges the parts.
+
+   Exercises the user thread system calls: the threads share the
+   array in the process's address space, and the main thread
+   joins each of them before merging. */
+#include <stdio.h>
+#include <syscall.h>
+
+/* Size of array to sort. */
+#define SORT_SIZE 1024
+
+/* Number of threads to sort with. */
+#define THREAD_CNT 4
+
+/* Part of the array for one thread to sort. */
+struct part 
+  {
+    int *base;
+    int cnt;
+  };
+
+static int array[SORT_SIZE];
+static int merged[SORT_SIZE];
+
+/* Sorts the part of the array passed as AUX, by insertion. */
+static void
+sort_part (void *aux) 
+{
+  struct part *part = aux;
+  int i, j;
+
+  for (i = 1; i < part->cnt; i++)
+    {
+      int x = part->base[i];
+      for (j = i; j > 0 && part->base[j - 1] > x; j--)
+        part->base[j] = part->base[j - 1];
+      part->base[j] = x;
+    }
+}
+
+int
+main (void)
+{
+  struct part parts[THREAD_CNT];
+  utid_t tids[THREAD_CNT];
+  int next[THREAD_CNT];
+  int i, j;
+
+  /* Initialize the array in descending order. */
+  for (i = 0; i < SORT_SIZE; i++)
+    array[i] = SORT_SIZE - i - 1;
+
+  /* Sort each part in its own thread. */
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      parts[i].base = array + i * (SORT_SIZE / THREAD_CNT);
+      parts[i].cnt = SORT_SIZE / THREAD_CNT;
+      tids[i] = uthread_create (sort_part, &parts[i]);
+      if (tids[i] == UTID_ERROR)
+        {
+          printf ("psort: uthread_create failed\n");
+          return EXIT_FAILURE;
+        }
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    uthread_join (tids[i]);
+
+  /* Merge the parts. */
+  for (i = 0; i < THREAD_CNT; i++)
+    next[i] = 0;
+  for (j = 0; j < SORT_SIZE; j++)
+    {
+      int best = -1;
+      for (i = 0; i < THREAD_CNT; i++)
+        if (next[i] < parts[i].cnt
+            && (best < 0
+                || parts[i].base[next[i]] < parts[best].base[next[best]]))
+          best = i;
+      merged[j] = parts[best].base[next[best]++];
+    }
+
+  for (j = 0; j < SORT_SIZE; j++)
+    if (merged[j] != j)
+      {
+        printf ("psort: element %d is %d\n", j, merged[j]);
+        return EXIT_FAILURE;
+      }
+  printf ("psort: sorted %d integers with %d threads\n",
+          SORT_SIZE, THREAD_CNT);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,28 @@
+#ifndef __LIB_INTR_STAT_H
+#define __LIB_INTR_STAT_H
+
+#include <stdint.h>
+
+/* Interrupt timing statistics, shared by the kernel and the
+   intr_stats() system call.
+
+   A statistic is selected by an interrupt vector number (0 to
+   255), for the time spent in that vector's handler, or by one
+   of the special values below. */
+#define INTR_STAT_OFF -1        /* Intervals with interrupts off. */
+#define INTR_STAT_YIELD -2      /* Interrupt-to-yield latency. */
+
+/* Number of histogram buckets.  Bucket N counts durations of
+   2**N to 2**(N+1) - 1 ns, except that bucket 0 also counts 0 ns
+   and the last bucket counts everything longer. */
+#define INTR_STAT_BUCKETS 32
+
+struct intr_stat
+  {
+    uint64_t count;             /* Number of intervals measured. */
+    uint64_t total_ns;          /* Sum of their durations. */
+    uint64_t max_ns;            /* Longest single duration. */
+    uint32_t hist[INTR_STAT_BUCKETS]; /* Log2 histogram, see above. */
+  };
+
+#endif /* lib/intr-stat.h */
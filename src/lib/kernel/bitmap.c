@@ -3,6 +3,7 @@
 #include <limits.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 #ifdef FILESYS
 #include "filesys/file.h"
@@ -21,13 +22,23 @@ typedef unsigned long elem_type;
 /* Number of bits in an element. */
 #define ELEM_BITS (sizeof (elem_type) * CHAR_BIT)
 
+/* An element with every bit set. */
+#define ELEM_ALL ((elem_type) -1)
+
 /* From the outside, a bitmap is an array of bits.  From the
    inside, it's an array of elem_type (defined above) that
-   simulates an array of bits. */
+   simulates an array of bits.
+
+   Operations on multiple bits work on whole elements at a time.
+   A bitmap may also have a summary, added by bitmap_summarize(),
+   with one bit per element that is set if every bit in the
+   element is set, which lets bitmap_scan() skip over full
+   elements 32 at a time when it looks for false bits. */
 struct bitmap
   {
     size_t bit_cnt;     /* Number of bits. */
     elem_type *bits;    /* Elements that represent bits. */
+    elem_type *full;    /* Summary of full elements, or null. */
   };
 
 /* Returns the index of the element that contains the bit
@@ -69,6 +80,43 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a mask of the CNT bits starting at bit OFS within an
+   element.  OFS + CNT must be between 1 and ELEM_BITS. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt) 
+{
+  elem_type low = cnt < ELEM_BITS ? ((elem_type) 1 << cnt) - 1 : ELEM_ALL;
+  return low << ofs;
+}
+
+/* Returns a mask of the bits actually used in element IDX of
+   B's bits. */
+static inline elem_type
+used_mask (const struct bitmap *b, size_t idx) 
+{
+  return idx == elem_cnt (b->bit_cnt) - 1 ? last_mask (b) : ELEM_ALL;
+}
+
+/* Returns the number of bits set in X. */
+static inline size_t
+popcount (elem_type x) 
+{
+  x -= (x >> 1) & (ELEM_ALL / 3);
+  x = (x & (ELEM_ALL / 15 * 3)) + ((x >> 2) & (ELEM_ALL / 15 * 3));
+  x = (x + (x >> 4)) & (ELEM_ALL / 255 * 15);
+  return (x * (ELEM_ALL / 255)) >> ((sizeof x - 1) * CHAR_BIT);
+}
+
+/* Returns the index of the lowest set bit in X, which must be
+   nonzero. */
+static inline size_t
+lowest_bit (elem_type x) 
+{
+  return __builtin_ctzl (x);
+}
+
+static void summary_update (struct bitmap *, size_t idx);
+
 /* Creation and destruction. */
 
 /* Creates and returns a pointer to a newly allocated bitmap with room for
@@ -82,6 +130,7 @@ bitmap_create (size_t bit_cnt)
   if (b != NULL)
     {
       b->bit_cnt = bit_cnt;
+      b->full = NULL;
       b->bits = malloc (byte_cnt (bit_cnt));
       if (b->bits != NULL || bit_cnt == 0)
         {
@@ -105,6 +154,7 @@ bitmap_create_in_buf (size_t bit_cnt, void *block, size_t block_size UNUSED)
 
   b->bit_cnt = bit_cnt;
   b->bits = (elem_type *) (b + 1);
+  b->full = NULL;
   bitmap_set_all (b, false);
   return b;
 }
@@ -124,10 +174,35 @@ bitmap_destroy (struct bitmap *b)
 {
   if (b != NULL) 
     {
+      free (b->full);
       free (b->bits);
       free (b);
     }
 }
+
+/* Adds a summary of full elements to B, which must have been
+   created by bitmap_create(), so that bitmap_scan() for false
+   bits runs quickly even when B is mostly true.  Keeping the
+   summary up to date makes changing bits a little slower.
+   Returns true if successful, false if memory allocation
+   fails. */
+bool
+bitmap_summarize (struct bitmap *b) 
+{
+  size_t i;
+
+  ASSERT (b != NULL);
+
+  if (b->full == NULL && b->bit_cnt > 0) 
+    {
+      b->full = calloc (elem_cnt (elem_cnt (b->bit_cnt)), sizeof (elem_type));
+      if (b->full == NULL)
+        return false;
+      for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+        summary_update (b, i);
+    }
+  return true;
+}
 
 /* Bitmap size. */
 
@@ -163,6 +238,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the OR instruction in [IA32-v2b]. */
   asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  summary_update (b, idx);
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -176,6 +252,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
   asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  summary_update (b, idx);
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -191,6 +268,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
   asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  summary_update (b, idx);
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -217,14 +295,28 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  while (cnt > 0) 
+    {
+      size_t idx = elem_idx (start);
+      size_t ofs = start % ELEM_BITS;
+      size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+      elem_type mask = range_mask (ofs, n);
+
+      /* Each element is updated atomically, as by bitmap_mark()
+         and bitmap_reset(). */
+      if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+      summary_update (b, idx);
+
+      start += n;
+      cnt -= n;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -232,17 +324,23 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t total = cnt;
+  size_t set_cnt = 0;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
-  return value_cnt;
+  while (cnt > 0) 
+    {
+      size_t ofs = start % ELEM_BITS;
+      size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+
+      set_cnt += popcount (b->bits[elem_idx (start)] & range_mask (ofs, n));
+      start += n;
+      cnt -= n;
+    }
+  return value ? set_cnt : total - set_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -250,15 +348,21 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
+  while (cnt > 0) 
+    {
+      size_t ofs = start % ELEM_BITS;
+      size_t n = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+      elem_type bits = b->bits[elem_idx (start)];
+
+      if ((value ? bits : ~bits) & range_mask (ofs, n))
+        return true;
+      start += n;
+      cnt -= n;
+    }
   return false;
 }
 
@@ -291,20 +395,98 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Works an element at a time, using the lowest set bit to find
+   where each run of VALUE bits begins and ends, so that it takes
+   time proportional to the number of elements and runs examined
+   rather than to the number of bits times CNT. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
+  size_t run_start = start;     /* Start of current run of VALUE bits. */
+  size_t run_cnt = 0;           /* Length of current run. */
+  size_t i = start;
+
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  if (cnt > b->bit_cnt || start > b->bit_cnt - cnt)
+    return BITMAP_ERROR;
+  if (cnt == 0)
+    return start;
+
+  while (i < b->bit_cnt) 
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t idx = elem_idx (i);
+      size_t ofs = i % ELEM_BITS;
+      size_t n, pos;
+      elem_type x;
+
+      /* Skip full elements, which have no false bits. */
+      if (!value && b->full != NULL && ofs == 0
+          && (b->full[elem_idx (idx)] & bit_mask (idx)) != 0) 
+        {
+          elem_type not_full;
+
+          do 
+            {
+              not_full = ~b->full[elem_idx (idx)] & ~(bit_mask (idx) - 1);
+              if (not_full != 0)
+                idx = idx - idx % ELEM_BITS + lowest_bit (not_full);
+              else
+                idx = idx - idx % ELEM_BITS + ELEM_BITS;
+            }
+          while (not_full == 0 && idx < elem_cnt (b->bit_cnt));
+          run_cnt = 0;
+          i = idx * ELEM_BITS;
+          continue;
+        }
+
+      /* X gets the N bits from I to the end of the element, or of
+         B, shifted down to bit 0, with VALUE bits as 1s. */
+      n = ELEM_BITS - ofs;
+      if (n > b->bit_cnt - i)
+        n = b->bit_cnt - i;
+      x = ((value ? b->bits[idx] : ~b->bits[idx]) >> ofs) & range_mask (0, n);
+
+      if (x == range_mask (0, n)) 
+        {
+          /* All N bits extend the current run. */
+          if (run_cnt == 0)
+            run_start = i;
+          run_cnt += n;
+          if (run_cnt >= cnt)
+            return run_start;
+        }
+      else
+        for (pos = 0; pos < n; ) 
+          {
+            /* Extend the run with the 1s starting at POS.  X has a
+               0 somewhere, so ~(X >> POS) is nonzero. */
+            size_t ones = lowest_bit (~(x >> pos));
+            if (ones > n - pos)
+              ones = n - pos;
+            if (ones > 0) 
+              {
+                if (run_cnt == 0)
+                  run_start = i + pos;
+                run_cnt += ones;
+                if (run_cnt >= cnt)
+                  return run_start;
+                pos += ones;
+                if (pos >= n)
+                  break;
+              }
+
+            /* Skip the 0s that end the run. */
+            run_cnt = 0;
+            if ((x >> pos) == 0)
+              break;
+            pos += lowest_bit (x >> pos);
+          }
+
+      i += n;
     }
   return BITMAP_ERROR;
 }
@@ -344,8 +526,12 @@ bitmap_read (struct bitmap *b, struct file *file)
   if (b->bit_cnt > 0) 
     {
       off_t size = byte_cnt (b->bit_cnt);
+      size_t i;
+
       success = file_read_at (file, b->bits, size, 0) == size;
       b->bits[elem_cnt (b->bit_cnt) - 1] &= last_mask (b);
+      for (i = 0; i < elem_cnt (b->bit_cnt); i++)
+        summary_update (b, i);
     }
   return success;
 }
@@ -360,6 +546,30 @@ bitmap_write (const struct bitmap *b, struct file *file)
 }
 #endif /* FILESYS */
 
+/* Summary maintenance. */
+
+/* Brings B's summary bit for element IDX up to date, if B has a
+   summary.  Interrupts are disabled so that the element is not
+   changed between reading it and updating the summary: then,
+   although bits are changed and summarized in separate steps,
+   the summary is correct once every change has been
+   summarized. */
+static void
+summary_update (struct bitmap *b, size_t idx) 
+{
+  if (b->full != NULL) 
+    {
+      enum intr_level old_level = intr_disable ();
+      elem_type used = used_mask (b, idx);
+
+      if ((b->bits[idx] & used) == used)
+        b->full[elem_idx (idx)] |= bit_mask (idx);
+      else
+        b->full[elem_idx (idx)] &= ~bit_mask (idx);
+      intr_set_level (old_level);
+    }
+}
+
 /* Debugging. */
 
 /* Dumps the contents of B to the console as hexadecimal. */
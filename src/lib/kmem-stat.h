@@ -0,0 +1,45 @@
+#ifndef __LIB_KMEM_STAT_H
+#define __LIB_KMEM_STAT_H
+
+#include <stdint.h>
+
+/* Kernel memory usage statistics, shared by the kernel and the
+   kmem_stats() system call.  Counts are in pages unless noted
+   otherwise. */
+
+/* Most malloc() size classes reported. */
+#define KMEM_CLASS_MAX 8
+
+/* A page allocator pool. */
+struct kmem_pool_stat
+  {
+    uint32_t pages;             /* Pages owned by the pool. */
+    uint32_t free;              /* Pages free. */
+    uint32_t used;              /* Pages allocated. */
+    uint32_t peak_used;         /* Most pages ever allocated at once. */
+    uint32_t largest_free;      /* Largest free block. */
+  };
+
+/* A malloc() size class. */
+struct kmem_class_stat
+  {
+    uint32_t block_size;        /* Block size in bytes. */
+    uint32_t blocks_per_arena;  /* Blocks in each one-page arena. */
+    uint32_t arenas;            /* Arenas allocated. */
+    uint32_t peak_arenas;       /* Most arenas ever allocated. */
+    uint32_t in_use;            /* Blocks not free in arenas. */
+  };
+
+struct kmem_stats
+  {
+    struct kmem_pool_stat kernel;       /* Kernel pool. */
+    struct kmem_pool_stat user;         /* User pool. */
+    uint32_t reservoir;                 /* Pages in shared reservoir. */
+    uint32_t class_cnt;                 /* Elements used in CLASSES. */
+    struct kmem_class_stat classes[KMEM_CLASS_MAX];
+    uint32_t big_blocks;                /* malloc() blocks over a page. */
+    uint32_t big_pages;                 /* Pages in those blocks. */
+    uint32_t peak_big_pages;            /* Most pages ever in them. */
+  };
+
+#endif /* lib/kmem-stat.h */
@@ -0,0 +1,131 @@
+#include <synch.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <syscall.h>
+
+/* Atomically stores NEW into *P and returns the old value.  See
+   [IA32-v2b] "XCHG". */
+static inline int
+atomic_xchg (int *p, int new) 
+{
+  asm volatile ("xchgl %0, %1" : "+r" (new), "+m" (*p) : : "memory");
+  return new;
+}
+
+/* Atomically stores NEW into *P if *P equals OLD, and returns
+   the value *P had.  See [IA32-v2a] "CMPXCHG". */
+static inline int
+atomic_cmpxchg (int *p, int old, int new) 
+{
+  asm volatile ("lock cmpxchgl %2, %1"
+                : "+a" (old), "+m" (*p) : "r" (new) : "memory");
+  return old;
+}
+
+/* Atomically adds N to *P and returns the old value.  See
+   [IA32-v2b] "XADD". */
+static inline int
+atomic_add (int *p, int n) 
+{
+  asm volatile ("lock xaddl %0, %1" : "+r" (n), "+m" (*p) : : "memory");
+  return n;
+}
+
+/* Initializes MUTEX as unlocked. */
+void
+mutex_init (struct mutex *mutex) 
+{
+  mutex->state = 0;
+}
+
+/* Acquires MUTEX, sleeping until it is available if necessary.
+
+   A mutex's state is 0 if it is unlocked, 1 if it is locked and
+   no thread is waiting for it, and 2 if threads may be waiting.
+   A thread that finds the mutex locked sets the state to 2
+   before sleeping, so that the unlocking thread knows it must
+   wake one up. */
+void
+mutex_lock (struct mutex *mutex) 
+{
+  int state = atomic_cmpxchg (&mutex->state, 0, 1);
+
+  if (state == 0)
+    return;
+  if (state != 2)
+    state = atomic_xchg (&mutex->state, 2);
+  while (state != 0) 
+    {
+      futex_wait (&mutex->state, 2);
+      state = atomic_xchg (&mutex->state, 2);
+    }
+}
+
+/* Acquires MUTEX if it is unlocked, without sleeping.  Returns
+   true if successful, false if MUTEX was locked. */
+bool
+mutex_trylock (struct mutex *mutex) 
+{
+  return atomic_cmpxchg (&mutex->state, 0, 1) == 0;
+}
+
+/* Releases MUTEX, which the running thread must hold, waking up
+   a thread waiting for it, if any. */
+void
+mutex_unlock (struct mutex *mutex) 
+{
+  if (atomic_add (&mutex->state, -1) != 1) 
+    {
+      mutex->state = 0;
+      futex_wake (&mutex->state, 1);
+    }
+}
+
+/* Initializes condition variable COND. */
+void
+condvar_init (struct condvar *cond) 
+{
+  cond->seq = 0;
+  cond->waiters = 0;
+}
+
+/* Atomically releases MUTEX and waits for COND to be signaled,
+   then reacquires MUTEX before returning.  MUTEX must be held.
+   As with the kernel's condition variables, the condition must
+   be rechecked after waking up. */
+void
+condvar_wait (struct condvar *cond, struct mutex *mutex) 
+{
+  int seq;
+
+  atomic_add (&cond->waiters, 1);
+  seq = cond->seq;
+  mutex_unlock (mutex);
+  futex_wait (&cond->seq, seq);
+  atomic_add (&cond->waiters, -1);
+
+  /* Other threads woken by a broadcast may be competing for
+     MUTEX, so lock it as contended. */
+  while (atomic_xchg (&mutex->state, 2) != 0)
+    futex_wait (&mutex->state, 2);
+}
+
+/* Wakes up one thread waiting on COND, if any. */
+void
+condvar_signal (struct condvar *cond) 
+{
+  if (cond->waiters == 0)
+    return;
+  atomic_add (&cond->seq, 1);
+  futex_wake (&cond->seq, 1);
+}
+
+/* Wakes up all threads waiting on COND. */
+void
+condvar_broadcast (struct condvar *cond) 
+{
+  if (cond->waiters == 0)
+    return;
+  atomic_add (&cond->seq, 1);
+  futex_wake (&cond->seq, INT_MAX);
+}
@@ -0,0 +1,37 @@
+#ifndef __LIB_USER_SYNCH_H
+#define __LIB_USER_SYNCH_H
+
+#include <stdbool.h>
+
+/* Mutexes and condition variables for user threads.
+
+   Their state is kept in user memory and updated with atomic
+   instructions, so that locking an unlocked mutex, unlocking a
+   mutex no thread is waiting for, and signaling a condition no
+   thread is waiting on do not enter the kernel.  Threads that
+   must wait sleep in futex_wait(). */
+
+/* Mutex. */
+struct mutex 
+  {
+    int state;                  /* 0: unlocked, 1: locked, 2: contended. */
+  };
+
+void mutex_init (struct mutex *);
+void mutex_lock (struct mutex *);
+bool mutex_trylock (struct mutex *);
+void mutex_unlock (struct mutex *);
+
+/* Condition variable. */
+struct condvar 
+  {
+    int seq;                    /* Incremented by each signal. */
+    int waiters;                /* Number of threads waiting. */
+  };
+
+void condvar_init (struct condvar *);
+void condvar_wait (struct condvar *, struct mutex *);
+void condvar_signal (struct condvar *);
+void condvar_broadcast (struct condvar *);
+
+#endif /* lib/user/synch.h */
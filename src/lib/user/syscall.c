@@ -182,3 +182,61 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+/* Entry point of a thread started by uthread_create(): runs
+   FUNC, passing AUX, and exits the thread if FUNC returns. */
+static void NO_RETURN
+uthread_start (uthread_func *func, void *aux) 
+{
+  func (aux);
+  uthread_exit (0);
+}
+
+utid_t
+uthread_create (uthread_func *func, void *aux) 
+{
+  return (utid_t) syscall3 (SYS_THREAD_CREATE, uthread_start, func, aux);
+}
+
+int
+uthread_join (utid_t tid) 
+{
+  return syscall1 (SYS_THREAD_JOIN, tid);
+}
+
+void
+uthread_exit (int status) 
+{
+  syscall1 (SYS_THREAD_EXIT, status);
+  NOT_REACHED ();
+}
+
+int
+futex_wait (int *word, int expected) 
+{
+  return syscall2 (SYS_FUTEX_WAIT, word, expected);
+}
+
+int
+futex_wake (int *word, int cnt) 
+{
+  return syscall2 (SYS_FUTEX_WAKE, word, cnt);
+}
+
+bool
+intr_stats (int which, struct intr_stat *stat) 
+{
+  return syscall2 (SYS_INTR_STATS, which, stat);
+}
+
+bool
+kmem_stats (struct kmem_stats *stats) 
+{
+  return syscall1 (SYS_KMEM_STATS, stats);
+}
+
+bool
+map_large (void *addr, size_t size) 
+{
+  return syscall2 (SYS_MAP_LARGE, addr, size);
+}
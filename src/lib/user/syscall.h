@@ -2,7 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
+#include <intr-stat.h>
+#include <kmem-stat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,22 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* User threads. */
+typedef int utid_t;
+#define UTID_ERROR ((utid_t) -1)
+typedef void uthread_func (void *aux);
+utid_t uthread_create (uthread_func *, void *aux);
+int uthread_join (utid_t);
+void uthread_exit (int status) NO_RETURN;
+int futex_wait (int *, int expected);
+int futex_wake (int *, int cnt);
+
+/* Statistics. */
+bool intr_stats (int which, struct intr_stat *);
+bool kmem_stats (struct kmem_stats *);
+
+/* Memory. */
+#define LARGE_PAGE_SIZE (4 * 1024 * 1024) /* Alignment for map_large(). */
+bool map_large (void *addr, size_t size);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,155 @@
+/* Test program for lib/kernel/bitmap.c.
+
+   Checks bitmap_scan(), bitmap_count(), bitmap_contains(), and
+   bitmap_set_multiple() against a simple array of bools over
+   random operations, with and without a summary, then measures
+   how fast bitmap_scan() finds runs of false bits in a large
+   bitmap at varying fill levels.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+
+/* Size of bitmaps checked against the reference. */
+#define CHECK_BITS 700
+
+/* Size of the bitmap used for timing, about the number of
+   sectors on a 64 MB disk. */
+#define BENCH_BITS (128 * 1024)
+
+/* Scans timed at each fill level. */
+#define BENCH_SCANS 200
+
+static void check_random (bool summarize);
+static size_t reference_scan (const bool[], size_t bit_cnt,
+                              size_t start, size_t cnt, bool value);
+static void bench (int fill_pct, bool summarize);
+
+/* Test and time the bitmap implementation. */
+void
+test (void)
+{
+  static const int fills[] = {0, 50, 90, 99};
+  size_t i;
+
+  check_random (false);
+  check_random (true);
+  printf ("bitmap: operations agree with reference\n");
+
+  for (i = 0; i < sizeof fills / sizeof *fills; i++)
+    {
+      bench (fills[i], false);
+      bench (fills[i], true);
+    }
+}
+
+/* Applies random operations to bitmaps of random sizes and to
+   an array of bools, checking that queries agree. */
+static void
+check_random (bool summarize)
+{
+  static bool ref[CHECK_BITS];
+  int iter;
+
+  for (iter = 0; iter < 200; iter++)
+    {
+      size_t bit_cnt = random_ulong () % CHECK_BITS;
+      struct bitmap *b = bitmap_create (bit_cnt);
+      unsigned fill = random_ulong () % 100;
+      int op;
+
+      ASSERT (b != NULL);
+      if (summarize)
+        ASSERT (bitmap_summarize (b));
+      memset (ref, 0, sizeof ref);
+
+      for (op = 0; op < 100; op++)
+        {
+          size_t start = random_ulong () % (bit_cnt + 1);
+          size_t cnt = random_ulong () % (bit_cnt - start + 1);
+          bool value = random_ulong () % 100 < fill;
+          size_t scan_cnt = random_ulong () % 40;
+          size_t i, expect;
+
+          bitmap_set_multiple (b, start, cnt, value);
+          for (i = 0; i < cnt; i++)
+            ref[start + i] = value;
+
+          start = random_ulong () % (bit_cnt + 1);
+          cnt = random_ulong () % (bit_cnt - start + 1);
+          value = random_ulong () % 2;
+          ASSERT (bitmap_scan (b, start, scan_cnt, value)
+                  == reference_scan (ref, bit_cnt, start, scan_cnt, value));
+
+          expect = 0;
+          for (i = 0; i < cnt; i++)
+            expect += ref[start + i] == value;
+          ASSERT (bitmap_count (b, start, cnt, value) == expect);
+          ASSERT (bitmap_contains (b, start, cnt, value) == (expect > 0));
+        }
+      bitmap_destroy (b);
+    }
+}
+
+/* Returns the first run of CNT bits equal to VALUE in REF, at or
+   after START, by brute force. */
+static size_t
+reference_scan (const bool ref[], size_t bit_cnt,
+                size_t start, size_t cnt, bool value)
+{
+  size_t i, j;
+
+  if (cnt > bit_cnt)
+    return BITMAP_ERROR;
+  for (i = start; i + cnt <= bit_cnt; i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (ref[i + j] != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Times scans for runs of 1 and 8 false bits in a bitmap of
+   BENCH_BITS bits, FILL_PCT percent of which are true, with the
+   true bits in the leading part, as on a disk that fills up from
+   the beginning, and a few false bits scattered through it. */
+static void
+bench (int fill_pct, bool summarize)
+{
+  struct bitmap *b = bitmap_create (BENCH_BITS);
+  size_t full = BENCH_BITS / 100 * fill_pct;
+  size_t cnt;
+  int i;
+
+  ASSERT (b != NULL);
+  if (summarize)
+    ASSERT (bitmap_summarize (b));
+  bitmap_set_multiple (b, 0, full, true);
+  for (i = 0; i < 16 && full > 0; i++)
+    bitmap_reset (b, random_ulong () % full);
+
+  for (cnt = 1; cnt <= 8; cnt *= 8)
+    {
+      int64_t start = timer_ns ();
+
+      for (i = 0; i < BENCH_SCANS; i++)
+        bitmap_scan (b, 0, cnt, false);
+      printf ("bitmap: %2d%% full, %s summary, run of %zu: %"PRId64" ns\n",
+              fill_pct, summarize ? "with" : "no", cnt,
+              (timer_ns () - start) / BENCH_SCANS);
+    }
+  bitmap_destroy (b);
+}
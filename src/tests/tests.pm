@@ -177,6 +177,11 @@ sub compare_output {
 			&& !/^ esi=.* edi=.* esp=.* ebp=.*/
 			&& !/^ cs=.* ds=.* es=.* ss=.*/, @output);
     }
+    my $ignore_reports = exists $options{IGNORE_REPORTS};
+    if ($ignore_reports) {
+	delete $options{IGNORE_REPORTS};
+	@output = grep (!/^\([a-zA-Z0-9-_]+\) report: /, @output);
+    }
     die "unknown option " . (keys (%options))[0] . "\n" if %options;
 
     my ($msg);
@@ -224,6 +229,8 @@ sub compare_output {
       if $ignore_exit_codes;
     $msg .= "\n(User fault messages are excluded for matching purposes.)\n"
       if $ignore_user_faults;
+    $msg .= "\n(Reported measurements are excluded for matching purposes.)\n"
+      if $ignore_reports;
     fail "Test output failed to match any acceptable form.\n\n$msg";
 }
 
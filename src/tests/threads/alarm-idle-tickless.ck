@@ -0,0 +1,5 @@
+# -*- perl -*-
+use tests::tests;
+use tests::threads::alarm;
+check_tickless ();
+check_alarm_idle ();
@@ -0,0 +1,100 @@
+/* Creates many threads that repeatedly sleep, in the style of
+   alarm-multiple, and measures how many of the timer ticks that
+   elapse meanwhile are spent in the idle thread.  Sleeping
+   threads should not consume CPU time, so nearly all of those
+   ticks should be idle. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Number of sleeping threads. */
+#define THREAD_CNT 100
+
+/* Number of times each thread sleeps. */
+#define ITERATIONS 7
+
+/* Information about the test. */
+struct sleep_test 
+  {
+    int64_t start;              /* Current time at start of test. */
+    struct semaphore done;      /* Upped by each thread as it exits. */
+  };
+
+/* Information about an individual thread in the test. */
+struct sleep_thread 
+  {
+    struct sleep_test *test;    /* Info shared between all threads. */
+    int duration;               /* Number of ticks to sleep. */
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_idle (void) 
+{
+  struct sleep_test test;
+  struct sleep_thread *threads;
+  int64_t start_ticks, start_idle, elapsed, idle;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Creating %d threads to sleep %d times each.",
+       THREAD_CNT, ITERATIONS);
+
+  threads = malloc (sizeof *threads * THREAD_CNT);
+  if (threads == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  test.start = timer_ticks () + 100;
+  sema_init (&test.done, 0);
+
+  start_ticks = timer_ticks ();
+  start_idle = thread_get_idle_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct sleep_thread *t = threads + i;
+      char name[16];
+
+      t->test = &test;
+      t->duration = (i % 5 + 1) * 10;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, sleeper, t);
+    }
+
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test.done);
+  elapsed = timer_elapsed (start_ticks);
+  idle = thread_get_idle_ticks () - start_idle;
+
+  msg ("%"PRId64" of %"PRId64" ticks idle.", idle, elapsed);
+  if (idle * 2 < elapsed)
+    fail ("sleeping threads kept the CPU busy for more than half "
+          "of the test");
+  msg ("At least half of the ticks were idle.");
+
+  free (threads);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *t_) 
+{
+  struct sleep_thread *t = t_;
+  struct sleep_test *test = t->test;
+  int i;
+
+  for (i = 1; i <= ITERATIONS; i++) 
+    {
+      int64_t sleep_until = test->start + i * t->duration;
+      timer_sleep (sleep_until - timer_ticks ());
+    }
+  sema_up (&test->done);
+}
@@ -0,0 +1,43 @@
+/* Sleeps repeatedly for a fraction of a timer tick with
+   timer_usleep() and checks, using the nanosecond clock, that
+   each sleep lasts at least as long as requested but, on
+   average, less than one timer tick.  Sleeps that are rounded
+   up to tick boundaries would take a whole tick each. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+/* Number of sleeps. */
+#define SLEEP_CNT 50
+
+/* Length of each sleep, in microseconds. */
+#define SLEEP_US 300
+
+void
+test_alarm_nsleep (void) 
+{
+  int64_t total = 0;
+  int i;
+
+  msg ("Sleeping %d times for %d us each.", SLEEP_CNT, SLEEP_US);
+
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      int64_t start = timer_ns ();
+      int64_t elapsed;
+
+      timer_usleep (SLEEP_US);
+      elapsed = timer_ns () - start;
+      if (elapsed < SLEEP_US * 1000)
+        fail ("sleep %d lasted only %"PRId64" ns", i, elapsed);
+      total += elapsed;
+    }
+
+  msg ("Average sleep took %"PRId64" us.", total / SLEEP_CNT / 1000);
+  if (total / SLEEP_CNT >= 1000000000 / TIMER_FREQ)
+    fail ("sleeps were rounded up to whole timer ticks");
+  msg ("Sleeps were shorter than a timer tick.");
+}
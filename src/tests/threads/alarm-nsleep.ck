@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+local ($_);
+my ($us);
+foreach (@output) {
+    ($us) = /Average sleep took (\d+) us\./ and last;
+}
+fail "Average sleep time missing from output.\n" if !defined $us;
+fail "Average sleep took $us us, at least a timer tick.\n" if $us >= 10000;
+pass;
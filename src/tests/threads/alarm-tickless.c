@@ -0,0 +1,63 @@
+/* Sleeps for a range of tick counts while no other thread is
+   ready, so that with -tickless the periodic tick stops for most
+   of each sleep.  Checks that each sleep ends exactly on its
+   wake-up tick and takes about as long as it should, so that the
+   ticks skipped while idle were counted neither too early nor
+   too late.  After each sleep, also sleeps for a fraction of a
+   tick with timer_usleep() and checks that it ends within the
+   tick. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "devices/timer.h"
+
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+/* Length of each short sleep, in microseconds. */
+#define SHORT_US 300
+
+void
+test_alarm_tickless (void)
+{
+  static const int durations[] = {2, 3, 5, 8, 13, 21, 34, 55, 89};
+  int64_t late_max = 0;
+  size_t i;
+
+  for (i = 0; i < sizeof durations / sizeof *durations; i++)
+    {
+      int n = durations[i];
+      int64_t start, start_ns, ns, woke;
+
+      /* Start just after a tick boundary. */
+      start = timer_ticks ();
+      while (timer_ticks () == start)
+        continue;
+      start = timer_ticks ();
+      start_ns = timer_ns ();
+
+      timer_sleep (n);
+      woke = timer_elapsed (start);
+      ns = timer_ns () - start_ns;
+      if (woke != n)
+        fail ("sleep for %d ticks woke up after %"PRId64" ticks", n, woke);
+      if (ns < (n - 1) * (int64_t) NS_PER_TICK
+          || ns > (n + 1) * (int64_t) NS_PER_TICK)
+        fail ("sleep for %d ticks took %"PRId64" ns", n, ns);
+      if (ns - n * (int64_t) NS_PER_TICK > late_max)
+        late_max = ns - n * (int64_t) NS_PER_TICK;
+
+      start_ns = timer_ns ();
+      timer_usleep (SHORT_US);
+      ns = timer_ns () - start_ns;
+      if (ns < SHORT_US * 1000 || ns >= NS_PER_TICK)
+        fail ("sleep for %d us after %d idle ticks took %"PRId64" ns",
+              SHORT_US, n, ns);
+    }
+
+  report ("Sleeps ended at most %"PRId64" ns after their wake-up ticks.",
+          late_max);
+  msg ("Sleeps woke up on their wake-up ticks.");
+  msg ("Short sleeps after idle periods lasted less than a tick.");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::threads::alarm;
+check_tickless ();
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(alarm-tickless) begin
+(alarm-tickless) Sleeps woke up on their wake-up ticks.
+(alarm-tickless) Short sleeps after idle periods lasted less than a tick.
+(alarm-tickless) end
+EOF
+pass;
@@ -29,4 +29,38 @@ sub check_alarm {
     pass;
 }
 
+sub check_alarm_idle {
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+    common_checks ("run", @output);
+    @output = get_core_output ("run", @output);
+
+    local ($_);
+    my ($idle, $elapsed);
+    foreach (@output) {
+	($idle, $elapsed) = /(\d+) of (\d+) ticks idle\./ and last;
+    }
+    fail "Idle tick count missing from output.\n" if !defined $idle;
+    fail "Only $idle of $elapsed ticks were idle.\n" if $idle * 2 < $elapsed;
+    pass;
+}
+
+# Fails unless the kernel ran with -tickless and skipped at least
+# one timer interrupt while idle.
+sub check_tickless {
+    our ($test);
+
+    my (@output) = read_text_file ("$test.output");
+
+    local ($_);
+    my ($skipped);
+    foreach (@output) {
+	($skipped) = /^Timer: (\d+) ticks passed without an interrupt$/
+	  and last;
+    }
+    fail "Kernel did not run with -tickless.\n" if !defined $skipped;
+    fail "No timer ticks were skipped while idle.\n" if $skipped == 0;
+}
+
 1;
@@ -0,0 +1,96 @@
+/* Has WAITER_CNT threads wait for a completion and measures how
+   long it takes after complete() until the last of them runs,
+   over ROUNDS rounds.  Also measures the cost of waiting for a
+   completion that is already complete, and checks that waiters
+   block until complete() and that every waiter is woken exactly
+   once. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define WAITER_CNT 8            /* Threads waiting per round. */
+#define ROUNDS 20               /* Rounds to run. */
+#define ITERATIONS 100000       /* Waits on a completed completion. */
+
+/* State shared by one round's threads. */
+struct completion_test 
+  {
+    struct completion go;       /* Completion being waited for. */
+    struct semaphore done;      /* Upped by each waiter as it exits. */
+    int64_t last_wake;          /* Time at which the last waiter ran. */
+    int woken;                  /* Number of waiters woken. */
+  };
+
+static thread_func waiter_func;
+
+void
+test_completion_bench (void) 
+{
+  struct completion c;
+  int64_t start, fast_ns, total_ns = 0, max_ns = 0;
+  int round, i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  completion_init (&c);
+  if (completion_done (&c))
+    fail ("New completion is already done.");
+  complete (&c);
+  if (!completion_done (&c))
+    fail ("Completion is not done after complete().");
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++)
+    completion_wait (&c);
+  fast_ns = timer_ns () - start;
+  report ("Waiting on a completed completion: %"PRId64" ps.",
+          fast_ns * 1000 / ITERATIONS);
+
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      struct completion_test test;
+      int64_t wake_ns;
+
+      completion_init (&test.go);
+      sema_init (&test.done, 0);
+      test.woken = 0;
+
+      /* The waiters preempt us and block on the completion. */
+      for (i = 0; i < WAITER_CNT; i++)
+        thread_create ("waiter", PRI_DEFAULT + 1, waiter_func, &test);
+      if (test.woken != 0)
+        fail ("%d waiters ran before complete().", test.woken);
+
+      start = timer_ns ();
+      complete (&test.go);
+      for (i = 0; i < WAITER_CNT; i++)
+        sema_down (&test.done);
+
+      if (test.woken != WAITER_CNT)
+        fail ("%d of %d waiters woken", test.woken, WAITER_CNT);
+      wake_ns = test.last_wake - start;
+      total_ns += wake_ns;
+      if (wake_ns > max_ns)
+        max_ns = wake_ns;
+    }
+  report ("Waking %d waiters: %"PRId64" ns on average, "
+          "%"PRId64" ns at most.", WAITER_CNT, total_ns / ROUNDS, max_ns);
+  msg ("Waiters blocked until complete() was called.");
+  msg ("Every waiter was woken once per round.");
+}
+
+static void
+waiter_func (void *test_) 
+{
+  struct completion_test *test = test_;
+
+  completion_wait (&test->go);
+  test->last_wake = timer_ns ();
+  test->woken++;
+  sema_up (&test->done);
+}
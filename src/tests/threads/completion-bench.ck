@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(completion-bench) begin
+(completion-bench) Waiters blocked until complete() was called.
+(completion-bench) Every waiter was woken once per round.
+(completion-bench) end
+EOF
+pass;
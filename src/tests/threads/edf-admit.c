@@ -0,0 +1,63 @@
+/* Checks admission control for real-time threads: a thread may
+   reserve a share of the CPU only if the total reserved stays
+   within the limit, invalid parameters are rejected, and a share
+   becomes available again when its thread exits or returns to
+   normal scheduling. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define MS (1000 * 1000)        /* Nanoseconds per millisecond. */
+
+static thread_func child_func;
+
+void
+test_edf_admit (void) 
+{
+  struct semaphore done;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+
+  msg ("Reserving 30%% for the main thread.");
+  if (!thread_set_realtime (100 * MS, 30 * MS, 0))
+    fail ("30%% of an idle CPU was not admitted.");
+  if (thread_set_realtime (100 * MS, 95 * MS, 0))
+    fail ("95%% of the CPU was admitted.");
+  if (thread_set_realtime (100 * MS, 0, 0))
+    fail ("Zero budget was admitted.");
+  if (thread_set_realtime (100 * MS, 60 * MS, 50 * MS))
+    fail ("Budget beyond the deadline was admitted.");
+  if (thread_set_realtime (100 * MS, 50 * MS, 200 * MS))
+    fail ("Deadline beyond the period was admitted.");
+
+  /* Each child runs when we block, and reserves what it can. */
+  thread_create ("child 1", PRI_DEFAULT, child_func, &done);
+  sema_down (&done);
+  thread_create ("child 2", PRI_DEFAULT, child_func, &done);
+  sema_down (&done);
+
+  thread_clear_realtime ();
+  msg ("Reserving 90%% after returning to normal scheduling.");
+  if (!thread_set_realtime (100 * MS, 45 * MS, 50 * MS))
+    fail ("90%% of an idle CPU was not admitted.");
+  thread_clear_realtime ();
+}
+
+static void
+child_func (void *done_) 
+{
+  struct semaphore *done = done_;
+
+  if (thread_set_realtime (50 * MS, 35 * MS, 0))
+    fail ("%s: 70%% was admitted with 30%% reserved.", thread_name ());
+  if (!thread_set_realtime (50 * MS, 30 * MS, 0))
+    fail ("%s: 60%% was not admitted with 30%% reserved.", thread_name ());
+  msg ("%s: reserved 60%%.", thread_name ());
+  sema_up (done);
+}
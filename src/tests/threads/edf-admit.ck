@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-admit) begin
+(edf-admit) Reserving 30% for the main thread.
+(edf-admit) child 1: reserved 60%.
+(edf-admit) child 2: reserved 60%.
+(edf-admit) Reserving 90% after returning to normal scheduling.
+(edf-admit) end
+EOF
+pass;
@@ -0,0 +1,127 @@
+/* Runs two periodic real-time tasks alongside a real-time task
+   that overruns its budget in every period and a CPU-bound
+   normal thread at the highest priority, and counts the
+   deadlines the periodic tasks miss.  Budget enforcement must
+   keep the overrunning task from making them miss any, and the
+   normal thread must still get the CPU time left over. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MS (1000 * 1000)        /* Nanoseconds per millisecond. */
+
+/* A periodic real-time task. */
+struct task 
+  {
+    const char *name;           /* Task name. */
+    int64_t period;             /* Period. */
+    int64_t budget;             /* Budget per period. */
+    int64_t work;               /* Time spent computing per job. */
+    int jobs;                   /* Jobs to run. */
+    int misses;                 /* Deadlines missed. */
+  };
+
+static struct semaphore done;   /* Upped by each thread as it exits. */
+static volatile int running;    /* Periodic tasks not yet done. */
+static unsigned throttles;      /* Times the overrunning task ran out. */
+static volatile long long spins; /* Loop iterations of the normal thread. */
+
+static thread_func task_func, overrun_func, normal_func;
+static void compute (int64_t ns);
+
+void
+test_edf_mixed (void) 
+{
+  struct task tasks[2] = 
+    {
+      {"task 1", 50 * MS, 10 * MS, 5 * MS, 20, 0},
+      {"task 2", 100 * MS, 20 * MS, 10 * MS, 10, 0},
+    };
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  running = 2;
+
+  /* The real-time threads preempt us and set themselves up.  The
+     normal thread, at the highest priority, does not let us run
+     again until the others are done. */
+  for (i = 0; i < 2; i++)
+    thread_create (tasks[i].name, PRI_DEFAULT + 1, task_func, &tasks[i]);
+  thread_create ("overrun", PRI_DEFAULT + 1, overrun_func, NULL);
+  thread_create ("normal", PRI_MAX, normal_func, NULL);
+  for (i = 0; i < 4; i++)
+    sema_down (&done);
+
+  for (i = 0; i < 2; i++)
+    msg ("%s: %d jobs, %d deadline misses.",
+         tasks[i].name, tasks[i].jobs, tasks[i].misses);
+  if (throttles == 0)
+    fail ("Overrunning task was never throttled.");
+  msg ("Overrunning task was throttled.");
+  if (spins == 0)
+    fail ("Normal thread never ran.");
+  msg ("Normal thread ran.");
+}
+
+/* Runs the task passed as AUX for its number of jobs. */
+static void
+task_func (void *task_) 
+{
+  struct task *task = task_;
+  enum intr_level old_level;
+  int i;
+
+  if (!thread_set_realtime (task->period, task->budget, 0))
+    fail ("%s was not admitted.", task->name);
+  for (i = 0; i < task->jobs; i++) 
+    {
+      compute (task->work);
+      if (!thread_wait_next_period ())
+        task->misses++;
+    }
+  thread_clear_realtime ();
+  old_level = intr_disable ();
+  running--;
+  intr_set_level (old_level);
+  sema_up (&done);
+}
+
+/* Reserves 20% of the CPU, then tries to use all of it until the
+   periodic tasks are done. */
+static void
+overrun_func (void *aux UNUSED) 
+{
+  if (!thread_set_realtime (100 * MS, 20 * MS, 0))
+    fail ("Overrunning task was not admitted.");
+  while (running > 0)
+    continue;
+  throttles = thread_current ()->rt_throttles;
+  thread_clear_realtime ();
+  sema_up (&done);
+}
+
+/* Spins until the periodic tasks are done. */
+static void
+normal_func (void *aux UNUSED) 
+{
+  while (running > 0)
+    spins++;
+  sema_up (&done);
+}
+
+/* Busy-waits for NS nanoseconds. */
+static void
+compute (int64_t ns) 
+{
+  int64_t start = timer_ns ();
+  while (timer_ns () - start < ns)
+    continue;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(edf-mixed) begin
+(edf-mixed) task 1: 20 jobs, 0 deadline misses.
+(edf-mixed) task 2: 10 jobs, 0 deadline misses.
+(edf-mixed) Overrunning task was throttled.
+(edf-mixed) Normal thread ran.
+(edf-mixed) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Starts a high-resolution timer that expires shortly before the
+   next timer tick, so that the PIT counts down to it, and then a
+   second timer that expires sooner.  Checks that the second timer
+   fires on time, not when the PIT's countdown to the first timer
+   ends.  Repeats a few times. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
+
+/* Number of rounds. */
+#define ROUND_CNT 10
+
+#define NS_PER_TICK (1000000000 / TIMER_FREQ)
+
+static struct semaphore fired;
+
+static void timer_func (struct hrtimer *);
+
+void
+test_hrtimer_rearm (void)
+{
+  int64_t late_max = 0;
+  int i;
+
+  sema_init (&fired, 0);
+  for (i = 0; i < ROUND_CNT; i++)
+    {
+      struct hrtimer long_timer, short_timer;
+      int64_t long_fired, short_fired;
+      int64_t start, now;
+      enum intr_level old_level;
+
+      /* Start just after a tick boundary. */
+      start = timer_ticks ();
+      while (timer_ticks () == start)
+        continue;
+
+      hrtimer_init (&long_timer, timer_func, &long_fired);
+      hrtimer_init (&short_timer, timer_func, &short_fired);
+      old_level = intr_disable ();
+      now = timer_ns ();
+      hrtimer_start (&long_timer, now + NS_PER_TICK * 8 / 10);
+      hrtimer_start (&short_timer, now + NS_PER_TICK / 10);
+      intr_set_level (old_level);
+      sema_down (&fired);
+      sema_down (&fired);
+
+      if (short_fired >= long_timer.expires)
+        fail ("round %d: short timer fired %"PRId64" ns late, "
+              "with the long timer", i, short_fired - short_timer.expires);
+      if (short_fired - short_timer.expires > late_max)
+        late_max = short_fired - short_timer.expires;
+    }
+
+  report ("Short timers fired at most %"PRId64" ns late.", late_max);
+  msg ("Short timers fired before the long timers.");
+}
+
+/* Records when the timer fired and wakes up the test. */
+static void
+timer_func (struct hrtimer *t)
+{
+  int64_t *fired_at = t->aux;
+
+  *fired_at = timer_ns ();
+  sema_up (&fired);
+}
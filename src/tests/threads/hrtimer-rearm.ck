@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(hrtimer-rearm) begin
+(hrtimer-rearm) Short timers fired before the long timers.
+(hrtimer-rearm) end
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Turns on interrupt statistics, then runs alongside a spinning
+   thread of equal priority for a while and checks that timer
+   interrupts, interrupts-off intervals, and yields forced by the
+   timer were all measured consistently. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SPIN_TICKS 20           /* Ticks to share the CPU. */
+
+static thread_func spinner_func;
+static void check_stat (const char *name, int which, uint64_t min_count);
+
+void
+test_intr_stat (void) 
+{
+  struct semaphore done;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  if (!intr_stats_start ())
+    fail ("No TSC to time interrupts with.");
+
+  msg ("Sharing the CPU for %d ticks.", SPIN_TICKS);
+  sema_init (&done, 0);
+  thread_create ("spinner", PRI_DEFAULT, spinner_func, &done);
+  start = timer_ticks ();
+  while (timer_elapsed (start) < SPIN_TICKS)
+    continue;
+  sema_down (&done);
+
+  check_stat ("timer", 0x20, SPIN_TICKS);
+  check_stat ("interrupts off", INTR_STAT_OFF, 1);
+  check_stat ("interrupt to yield", INTR_STAT_YIELD, 1);
+  msg ("Statistics are consistent.");
+}
+
+static void
+spinner_func (void *done_) 
+{
+  struct semaphore *done = done_;
+  int64_t start = timer_ticks ();
+
+  while (timer_elapsed (start) < SPIN_TICKS)
+    continue;
+  sema_up (done);
+}
+
+/* Checks that the statistic selected by WHICH counts at least
+   MIN_COUNT intervals and that its histogram and maximum agree
+   with its count and total. */
+static void
+check_stat (const char *name, int which, uint64_t min_count) 
+{
+  struct intr_stat s;
+  uint64_t sum = 0;
+  int i;
+
+  if (!intr_stats_get (which, &s))
+    fail ("No %s statistic.", name);
+  if (s.count < min_count)
+    fail ("%s: %"PRIu64" intervals counted, expected at least %"PRIu64".",
+          name, s.count, min_count);
+  for (i = 0; i < INTR_STAT_BUCKETS; i++)
+    sum += s.hist[i];
+  if (sum != s.count)
+    fail ("%s: histogram holds %"PRIu64" intervals, expected %"PRIu64".",
+          name, sum, s.count);
+  if (s.max_ns > s.total_ns)
+    fail ("%s: maximum %"PRIu64" ns exceeds total %"PRIu64" ns.",
+          name, s.max_ns, s.total_ns);
+}
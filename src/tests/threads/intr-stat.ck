@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(intr-stat) begin
+(intr-stat) Sharing the CPU for 20 ticks.
+(intr-stat) Statistics are consistent.
+(intr-stat) end
+EOF
+pass;
@@ -0,0 +1,112 @@
+/* Checks the counters reported by kmem_get_stats().  Allocates
+   many small blocks of one size and then a big block, and checks
+   that the arenas, blocks, and pages they use show up in the
+   statistics and go away again when they are freed. */
+
+#include <debug.h>
+#include <inttypes.h>
+#include <kmem-stat.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/kmem.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Small blocks to allocate, and their size. */
+#define BLOCK_CNT 512
+#define BLOCK_SIZE 64
+
+/* Blocks that per-thread magazines may keep after being freed. */
+#define MAG_SLACK 32
+
+static void *blocks[BLOCK_CNT];
+
+static const struct kmem_class_stat *find_class (const struct kmem_stats *,
+                                                 size_t block_size);
+
+void
+test_kmem_stat (void) 
+{
+  static struct kmem_stats before, during, after;
+  const struct kmem_class_stat *c0, *c1, *c2;
+  void *big;
+  int i;
+
+  kmem_get_stats (&before);
+  c0 = find_class (&before, BLOCK_SIZE);
+  for (i = 0; i < BLOCK_CNT; i++) 
+    {
+      blocks[i] = malloc (BLOCK_SIZE);
+      if (blocks[i] == NULL)
+        fail ("malloc() failed after %d blocks.", i);
+    }
+  kmem_get_stats (&during);
+  c1 = find_class (&during, BLOCK_SIZE);
+  if (c1->in_use < c0->in_use + BLOCK_CNT)
+    fail ("%"PRIu32" blocks in use after allocating %d more than %"PRIu32".",
+          c1->in_use, BLOCK_CNT, c0->in_use);
+  if (c1->arenas * c1->blocks_per_arena < c1->in_use)
+    fail ("%"PRIu32" arenas cannot hold %"PRIu32" blocks.",
+          c1->arenas, c1->in_use);
+  if (c1->peak_arenas < c1->arenas)
+    fail ("Peak of %"PRIu32" arenas is below current %"PRIu32".",
+          c1->peak_arenas, c1->arenas);
+  if (during.kernel.used < before.kernel.used + c1->arenas - c0->arenas)
+    fail ("Kernel pool does not count new arenas as used.");
+  msg ("Small blocks counted.");
+
+  for (i = 0; i < BLOCK_CNT; i++)
+    free (blocks[i]);
+  kmem_get_stats (&after);
+  c2 = find_class (&after, BLOCK_SIZE);
+  if (c2->in_use > c0->in_use + MAG_SLACK)
+    fail ("%"PRIu32" blocks still in use after freeing.", c2->in_use);
+  if (c2->arenas >= c1->arenas)
+    fail ("%"PRIu32" arenas still allocated after freeing.", c2->arenas);
+  if (c2->peak_arenas < c1->arenas)
+    fail ("Peak of %"PRIu32" arenas forgotten.", c2->peak_arenas);
+  msg ("Freed small blocks uncounted.");
+
+  big = malloc (3 * PGSIZE);
+  if (big == NULL)
+    fail ("Big block allocation failed.");
+  kmem_get_stats (&during);
+  if (during.big_blocks != after.big_blocks + 1
+      || during.big_pages != after.big_pages + 4)
+    fail ("%"PRIu32" big blocks in %"PRIu32" pages, expected %"PRIu32
+          " in %"PRIu32".", during.big_blocks, during.big_pages,
+          after.big_blocks + 1, after.big_pages + 4);
+  if (during.kernel.peak_used < during.kernel.used)
+    fail ("Kernel pool peak below its current use.");
+  free (big);
+  kmem_get_stats (&after);
+  if (after.big_blocks != during.big_blocks - 1
+      || after.big_pages != during.big_pages - 4
+      || after.peak_big_pages < during.big_pages)
+    fail ("Big block statistics wrong after free.");
+  msg ("Big block counted.");
+
+  if (after.kernel.largest_free > after.kernel.free)
+    fail ("Largest free block of %"PRIu32" pages, but only %"PRIu32
+          " pages free.", after.kernel.largest_free, after.kernel.free);
+  if (after.kernel.free + after.kernel.used > after.kernel.pages)
+    fail ("Kernel pool has %"PRIu32" free and %"PRIu32" used pages "
+          "out of %"PRIu32".", after.kernel.free, after.kernel.used,
+          after.kernel.pages);
+  msg ("Pool counts consistent.");
+}
+
+/* Returns the statistics in S for blocks of BLOCK_SIZE bytes. */
+static const struct kmem_class_stat *
+find_class (const struct kmem_stats *s, size_t block_size) 
+{
+  uint32_t i;
+
+  for (i = 0; i < s->class_cnt; i++)
+    if (s->classes[i].block_size == block_size)
+      return &s->classes[i];
+  fail ("No statistics for %zu-byte blocks.", block_size);
+  NOT_REACHED ();
+}
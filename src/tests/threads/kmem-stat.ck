@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(kmem-stat) begin
+(kmem-stat) Small blocks counted.
+(kmem-stat) Freed small blocks uncounted.
+(kmem-stat) Big block counted.
+(kmem-stat) Pool counts consistent.
+(kmem-stat) end
+EOF
+pass;
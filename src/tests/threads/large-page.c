@@ -0,0 +1,70 @@
+/* Checks the kernel's mapping of physical memory: walks the base
+   page directory over every page of RAM, through 4 MB large
+   pages and page tables alike, and checks that each page maps to
+   the right physical address and is writable unless it holds
+   kernel text.  Also checks that, with large pages enabled,
+   every 4 MB-aligned 4 MB of RAM that does not overlap kernel
+   text is mapped with a large page, and that nothing else is. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/loader.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+
+void
+test_large_page (void) 
+{
+  extern char _start, _end_kernel_text;
+  uintptr_t text_start = vtop (&_start);
+  uintptr_t text_end = vtop (&_end_kernel_text);
+  size_t page, large_cnt = 0;
+
+  for (page = 0; page < init_ram_pages; page++) 
+    {
+      char *vaddr = ptov (page * PGSIZE);
+      bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
+      uint32_t pde = init_page_dir[pd_no (vaddr)];
+      uintptr_t span_start = page * PGSIZE / PTSPAN * PTSPAN;
+      uintptr_t span_end = span_start + PTSPAN;
+      bool want_large = (large_pages
+                         && span_end <= (uintptr_t) init_ram_pages * PGSIZE
+                         && (span_end <= text_start
+                             || span_start >= text_end));
+      uint32_t entry;
+      uintptr_t paddr;
+
+      if (!(pde & PTE_P))
+        fail ("No PDE for page %zu.", page);
+      if (((pde & PTE_PS) != 0) != want_large)
+        fail ("Page %zu is %smapped with a large page.", page,
+              want_large ? "not " : "");
+      if (pde & PTE_PS) 
+        {
+          entry = pde;
+          paddr = vtop (pde_get_large_page (pde)) + pt_no (vaddr) * PGSIZE;
+          large_cnt++;
+        }
+      else 
+        {
+          entry = pde_get_pt (pde)[pt_no (vaddr)];
+          if (!(entry & PTE_P))
+            fail ("No PTE for page %zu.", page);
+          paddr = entry & PTE_ADDR;
+        }
+
+      if (paddr != page * PGSIZE)
+        fail ("Page %zu maps physical address %#zx.", page, paddr);
+      if ((entry & PTE_U) != 0)
+        fail ("Page %zu is accessible to user code.", page);
+      if (((entry & PTE_W) != 0) == in_kernel_text)
+        fail ("Page %zu is %s.", page,
+              in_kernel_text ? "writable kernel text" : "read-only");
+    }
+
+  msg ("Kernel mapping of physical memory is correct.");
+  msg ("Large pages are used wherever they fit.");
+  report ("%zu of %zu kB mapped with large pages.",
+       large_cnt * PGSIZE / 1024, (size_t) init_ram_pages * PGSIZE / 1024);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(large-page) begin
+(large-page) Kernel mapping of physical memory is correct.
+(large-page) Large pages are used wherever they fit.
+(large-page) end
+EOF
+pass;
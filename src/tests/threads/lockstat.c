@@ -0,0 +1,61 @@
+/* Turns on lock statistics, then has a higher-priority thread
+   block on a lock held by the main thread ROUNDS times, and
+   checks that lockstat counted every acquisition and every
+   contended one. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/lockstat.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define ROUNDS 10               /* Contended acquisitions. */
+
+static thread_func contender_func;
+
+void
+test_lockstat (void) 
+{
+  struct lock lock;
+  struct lock_class *c;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  lockstat_enabled = true;
+  lock_init_named (&lock, "lockstat test");
+  c = lockstat_class ("lockstat test", NULL, true);
+
+  msg ("Contending for the lock %d times.", ROUNDS);
+  for (i = 0; i < ROUNDS; i++) 
+    {
+      /* The contender preempts us and blocks on the lock, then
+         preempts us again as soon as we release it. */
+      lock_acquire (&lock);
+      thread_create ("contender", PRI_DEFAULT + 1, contender_func, &lock);
+      lock_release (&lock);
+    }
+
+  if (c->acquired != 2 * ROUNDS)
+    fail ("%"PRIu64" acquisitions counted, expected %d.",
+          c->acquired, 2 * ROUNDS);
+  if (c->contended != ROUNDS)
+    fail ("%"PRIu64" contended acquisitions counted, expected %d.",
+          c->contended, ROUNDS);
+  if (c->max_wait_ns < 0 || c->max_wait_ns > c->wait_ns)
+    fail ("Maximum wait %"PRId64" ns is inconsistent with total %"PRId64" ns.",
+          c->max_wait_ns, c->wait_ns);
+  msg ("Every acquisition was counted.");
+}
+
+static void
+contender_func (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_release (lock);
+}
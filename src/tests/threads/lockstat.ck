@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(lockstat) begin
+(lockstat) Contending for the lock 10 times.
+(lockstat) Every acquisition was counted.
+(lockstat) end
+EOF
+pass;
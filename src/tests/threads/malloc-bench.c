@@ -0,0 +1,108 @@
+/* Measures malloc() and free() of small blocks with and without
+   per-thread magazines, both for a block freed right after it is
+   allocated and for batches of BATCH blocks allocated together
+   and then freed together, which makes magazines refill from and
+   drain to the shared free lists.  Checks that the blocks in a
+   batch do not overlap, and that with magazines a block freed
+   and allocated again right away is the same block.
+   malloc-mag checks the magazines' behavior across threads. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 2000         /* Blocks allocated per measurement. */
+#define BATCH 40                /* Blocks live at once in batches. */
+
+static int64_t time_pairs (size_t size);
+static int64_t time_batches (size_t size);
+
+void
+test_malloc_bench (void) 
+{
+  static const size_t sizes[] = {16, 100, 1000};
+  size_t i;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++) 
+    {
+      size_t size = sizes[i];
+      int64_t locked_pair, mag_pair, locked_batch, mag_batch;
+
+      malloc_magazines = false;
+      locked_pair = time_pairs (size);
+      locked_batch = time_batches (size);
+      malloc_magazines = true;
+      mag_pair = time_pairs (size);
+      mag_batch = time_batches (size);
+
+      report ("%zu bytes, one at a time: %"PRId64" ns locked, "
+              "%"PRId64" ns with magazines.", size, locked_pair, mag_pair);
+      report ("%zu bytes, %d at a time: %"PRId64" ns locked, "
+              "%"PRId64" ns with magazines.",
+              size, BATCH, locked_batch, mag_batch);
+    }
+  msg ("Blocks in each batch were distinct.");
+  msg ("Magazines handed a freed block straight back.");
+}
+
+/* Returns the average time to malloc() and then free() a block
+   of SIZE bytes. */
+static int64_t
+time_pairs (size_t size) 
+{
+  int64_t start = timer_ns ();
+  int64_t elapsed;
+  void *first = NULL;
+  bool same = true;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      void *p = malloc (size);
+      if (p == NULL)
+        fail ("malloc (%zu) failed.", size);
+      if (i == 0)
+        first = p;
+      else if (p != first)
+        same = false;
+      free (p);
+    }
+  elapsed = timer_ns () - start;
+
+  if (malloc_magazines && !same)
+    fail ("Magazine returned different %zu-byte blocks in a row.", size);
+  return elapsed / ITERATIONS;
+}
+
+/* Returns the average time per block to malloc() BATCH blocks of
+   SIZE bytes and then free() them all.  Marks the ends of each
+   block with its index in the batch and checks them before
+   freeing, to catch overlapping blocks. */
+static int64_t
+time_batches (size_t size) 
+{
+  uint8_t *blocks[BATCH];
+  int64_t start = timer_ns ();
+  int i, j;
+
+  for (i = 0; i < ITERATIONS / BATCH; i++) 
+    {
+      for (j = 0; j < BATCH; j++) 
+        {
+          blocks[j] = malloc (size);
+          if (blocks[j] == NULL)
+            fail ("malloc (%zu) failed.", size);
+          blocks[j][0] = blocks[j][size - 1] = j;
+        }
+      for (j = 0; j < BATCH; j++) 
+        {
+          if (blocks[j][0] != j || blocks[j][size - 1] != j)
+            fail ("%zu-byte block %d of a batch was overwritten.", size, j);
+          free (blocks[j]);
+        }
+    }
+  return (timer_ns () - start) / (ITERATIONS / BATCH * BATCH);
+}
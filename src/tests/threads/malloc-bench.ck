@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(malloc-bench) begin
+(malloc-bench) Blocks in each batch were distinct.
+(malloc-bench) Magazines handed a freed block straight back.
+(malloc-bench) end
+EOF
+pass;
@@ -0,0 +1,138 @@
+/* Checks the per-thread magazines in front of malloc()'s
+   descriptors across threads.  One thread allocates BLOCKS
+   blocks and a second frees them, which leaves some of them in
+   the second thread's magazine, still counted as in use.  A
+   third thread then allocates blocks and should be handed some
+   of those that the second thread freed.  Finally, once the
+   second thread exits, its magazine must be drained, so that
+   every block and arena goes back to where it was before the
+   test. */
+
+#include <debug.h>
+#include <inttypes.h>
+#include <kmem-stat.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/kmem.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define BLOCKS 64               /* Blocks allocated by each thread. */
+#define BLOCK_SIZE 512          /* Size of each block. */
+
+static void *blocks[BLOCKS];
+static int reused;
+static struct semaphore release;
+
+static thread_func alloc_func;
+static thread_func free_func;
+static thread_func reuse_func;
+static struct kmem_class_stat class_stat (void);
+
+void
+test_malloc_mag (void) 
+{
+  struct kmem_class_stat base, held, after;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  malloc_magazines = true;
+  sema_init (&release, 0);
+  base = class_stat ();
+
+  /* Each thread preempts us and runs until it exits or, for
+     free_func(), until it blocks on RELEASE. */
+  thread_create ("alloc", PRI_DEFAULT + 1, alloc_func, NULL);
+  thread_create ("free", PRI_DEFAULT + 1, free_func, NULL);
+  held = class_stat ();
+  if (held.in_use <= base.in_use || held.in_use >= base.in_use + BLOCKS)
+    fail ("%"PRIu32" blocks in use after freeing %d, %"PRIu32" before.",
+          held.in_use, BLOCKS, base.in_use);
+  msg ("A thread's magazine kept some of the blocks it freed.");
+
+  thread_create ("reuse", PRI_DEFAULT + 1, reuse_func, NULL);
+  if (reused == 0)
+    fail ("No block freed by one thread was reused by another.");
+  msg ("Blocks freed by one thread were reused by another.");
+
+  sema_up (&release);
+  after = class_stat ();
+  if (after.in_use != base.in_use)
+    fail ("%"PRIu32" blocks in use after all threads exited, "
+          "%"PRIu32" before.", after.in_use, base.in_use);
+  if (after.arenas != base.arenas)
+    fail ("%"PRIu32" arenas after all threads exited, %"PRIu32" before.",
+          after.arenas, base.arenas);
+  msg ("Exiting threads gave back every block and arena.");
+}
+
+/* Allocates BLOCKS blocks into BLOCKS[], marking each with its
+   index, and exits. */
+static void
+alloc_func (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < BLOCKS; i++) 
+    {
+      blocks[i] = malloc (BLOCK_SIZE);
+      if (blocks[i] == NULL)
+        fail ("malloc() failed after %d blocks.", i);
+      *(int *) blocks[i] = i;
+    }
+}
+
+/* Checks and frees the blocks in BLOCKS[], then waits for
+   RELEASE before exiting, keeping its magazine. */
+static void
+free_func (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < BLOCKS; i++) 
+    {
+      if (*(int *) blocks[i] != i)
+        fail ("Block %d was overwritten.", i);
+      free (blocks[i]);
+    }
+  sema_down (&release);
+}
+
+/* Allocates BLOCKS blocks, counts those that free_func() freed,
+   frees them all again, and exits. */
+static void
+reuse_func (void *aux UNUSED) 
+{
+  void *mine[BLOCKS];
+  int i, j;
+
+  for (i = 0; i < BLOCKS; i++) 
+    {
+      mine[i] = malloc (BLOCK_SIZE);
+      if (mine[i] == NULL)
+        fail ("malloc() failed after %d blocks.", i);
+      for (j = 0; j < BLOCKS; j++)
+        if (mine[i] == blocks[j])
+          reused++;
+    }
+  for (i = 0; i < BLOCKS; i++)
+    free (mine[i]);
+}
+
+/* Returns malloc()'s statistics for BLOCK_SIZE-byte blocks. */
+static struct kmem_class_stat
+class_stat (void) 
+{
+  static struct kmem_stats s;
+  uint32_t i;
+
+  kmem_get_stats (&s);
+  for (i = 0; i < s.class_cnt; i++)
+    if (s.classes[i].block_size == BLOCK_SIZE)
+      return s.classes[i];
+  fail ("No statistics for %d-byte blocks.", BLOCK_SIZE);
+  NOT_REACHED ();
+}
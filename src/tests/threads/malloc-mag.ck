@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(malloc-mag) begin
+(malloc-mag) A thread's magazine kept some of the blocks it freed.
+(malloc-mag) Blocks freed by one thread were reused by another.
+(malloc-mag) Exiting threads gave back every block and arena.
+(malloc-mag) end
+EOF
+pass;
@@ -0,0 +1,85 @@
+/* Checks that the MLFQS decays ready real-time threads along
+   with the other ready threads.
+
+   Two real-time threads are released together just before a
+   once-a-second decay.  One runs across the decay while the
+   other waits in the real-time ready queue.  Then each waits for
+   its next period, which blocks it.  A thread blocks only after
+   its recent_cpu has been decayed up to the current second, so
+   the kernel panics if the waiting thread was skipped. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MS (1000 * 1000)        /* Nanoseconds per millisecond. */
+
+/* Ticks that each real-time thread computes for. */
+#define WORK_TICKS 6
+
+static struct semaphore ready;  /* Upped by each thread once real-time. */
+static struct semaphore go;     /* Releases the threads. */
+static struct semaphore done;   /* Upped by each thread as it exits. */
+
+static thread_func rt_func;
+
+void
+test_mlfqs_edf (void)
+{
+  enum intr_level old_level;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&ready, 0);
+  sema_init (&go, 0);
+  sema_init (&done, 0);
+  for (i = 0; i < 2; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "rt %d", i);
+      thread_create (name, PRI_DEFAULT, rt_func, NULL);
+    }
+  for (i = 0; i < 2; i++)
+    sema_down (&ready);
+
+  /* Release both threads at once, a few ticks before the next
+     decay, so that the one that runs first is still computing
+     when the decay happens. */
+  while (timer_ticks () % TIMER_FREQ != TIMER_FREQ - WORK_TICKS / 2)
+    continue;
+  old_level = intr_disable ();
+  for (i = 0; i < 2; i++)
+    sema_up (&go);
+  intr_set_level (old_level);
+  thread_yield ();
+
+  for (i = 0; i < 2; i++)
+    sema_down (&done);
+  msg ("Real-time threads blocked after a decay.");
+}
+
+/* Becomes a real-time thread, waits to be released, computes
+   for WORK_TICKS ticks, and waits for the next period. */
+static void
+rt_func (void *aux UNUSED)
+{
+  int64_t start;
+
+  if (!thread_set_realtime (200 * MS, 80 * MS, 0))
+    fail ("%s was not admitted.", thread_name ());
+  sema_up (&ready);
+  sema_down (&go);
+
+  start = timer_ticks ();
+  while (timer_elapsed (start) < WORK_TICKS)
+    continue;
+  thread_wait_next_period ();
+
+  thread_clear_realtime ();
+  sema_up (&done);
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-edf) begin
+(mlfqs-edf) Real-time threads blocked after a decay.
+(mlfqs-edf) end
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Blocks 100 threads in timer_sleep() for longer than the test
+   runs, then spins for 40 seconds, long enough for the scheduler
+   to have to catch up the blocked threads' recent_cpu.  The
+   number of threads updated by any one timer tick, which the
+   kernel reports at shutdown, should stay small: it must not
+   grow with the number of blocked threads. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 100
+
+static void sleeper (void *);
+
+void
+test_mlfqs_tick_work (void) 
+{
+  int64_t start_time;
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  msg ("Creating %d threads to sleep for 60 seconds.", THREAD_CNT);
+  for (i = 0; i < THREAD_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, sleeper, NULL);
+    }
+
+  msg ("Spinning for 40 seconds...");
+  start_time = timer_ticks ();
+  while (timer_elapsed (start_time) < 40 * TIMER_FREQ)
+    continue;
+  msg ("Done spinning.");
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *aux UNUSED) 
+{
+  timer_sleep (60 * TIMER_FREQ);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+local ($_);
+my ($work);
+foreach (@output) {
+    ($work) = /at most (\d+) threads updated by one timer tick/ and last;
+}
+fail "Scheduler tick statistics missing from output.\n" if !defined $work;
+fail "One timer tick updated $work threads, but should update at most 20.\n"
+  if $work > 20;
+pass;
@@ -0,0 +1,198 @@
+/* Measures page allocation from the user pool: the time to
+   allocate and free single pages and random runs of up to
+   MAX_RUN pages while BLOCKS runs are live, and how fragmented
+   the pool is afterward, as the largest run that can still be
+   allocated compared with the number of free pages.  Also checks
+   that allocations never overlap, that each run starts on a
+   physical boundary of its size rounded up to a power of 2, as
+   the buddy allocator promises, and that freeing every run
+   merges the pool back together. */
+
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 4000         /* Allocations to time. */
+#define BLOCKS 128              /* Live runs during churn. */
+#define MAX_RUN 8               /* Largest run, in pages. */
+
+struct run 
+  {
+    uint8_t *pages;             /* First page, or null. */
+    size_t cnt;                 /* Number of pages. */
+  };
+
+static struct run runs[BLOCKS];
+
+static void run_alloc (struct run *);
+static void run_free (struct run *);
+static size_t largest_run (void);
+static size_t free_pages (void);
+static size_t block_pages (size_t cnt);
+
+void
+test_palloc_bench (void) 
+{
+  int64_t start, single_ns, churn_ns;
+  size_t largest, free_cnt, largest_before, largest_after;
+  int i;
+
+  random_init (0);
+  largest_before = largest_run ();
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      void *page = palloc_get_page (PAL_USER);
+      if (page == NULL)
+        fail ("palloc_get_page() failed.");
+      palloc_free_page (page);
+    }
+  single_ns = timer_ns () - start;
+
+  for (i = 0; i < BLOCKS; i++)
+    run_alloc (&runs[i]);
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      struct run *r = &runs[random_ulong () % BLOCKS];
+      run_free (r);
+      run_alloc (r);
+    }
+  churn_ns = timer_ns () - start;
+
+  /* Leave every other run allocated, to fragment the pool. */
+  for (i = 0; i < BLOCKS; i += 2)
+    run_free (&runs[i]);
+  largest = largest_run ();
+  free_cnt = free_pages ();
+  for (i = 1; i < BLOCKS; i += 2)
+    run_free (&runs[i]);
+  largest_after = largest_run ();
+
+  report ("Allocating a page: %"PRId64" ns.", single_ns / ITERATIONS);
+  report ("Allocating a run of 1 to %d pages: %"PRId64" ns.",
+          MAX_RUN, churn_ns / ITERATIONS);
+  report ("Largest free run: %zu of %zu free pages.", largest, free_cnt);
+  msg ("No allocations overlapped.");
+  msg ("Every run was aligned to its block size.");
+  if (largest > free_cnt)
+    fail ("Largest free run of %zu pages exceeds %zu free pages.",
+          largest, free_cnt);
+  if (largest_after < largest_before)
+    fail ("Largest free run shrank from %zu to %zu pages after "
+          "freeing everything.", largest_before, largest_after);
+  msg ("Freed runs merged back together.");
+}
+
+/* Allocates a run of random length into R and marks each of its
+   pages with R's address, so that run_free() can tell whether
+   another allocation overlapped it. */
+static void
+run_alloc (struct run *r) 
+{
+  size_t i;
+
+  r->cnt = random_ulong () % MAX_RUN + 1;
+  r->pages = palloc_get_multiple (PAL_USER, r->cnt);
+  if (r->pages == NULL)
+    fail ("palloc_get_multiple() failed for %zu pages.", r->cnt);
+  if (vtop (r->pages) / PGSIZE % block_pages (r->cnt) != 0)
+    fail ("Run of %zu pages at physical page %zu is misaligned.",
+          r->cnt, (size_t) (vtop (r->pages) / PGSIZE));
+  for (i = 0; i < r->cnt; i++)
+    memcpy (r->pages + i * PGSIZE, &r, sizeof r);
+}
+
+/* Checks R's marks and frees it. */
+static void
+run_free (struct run *r) 
+{
+  size_t i;
+
+  if (r->pages == NULL)
+    return;
+  for (i = 0; i < r->cnt; i++) 
+    {
+      struct run *mark;
+      memcpy (&mark, r->pages + i * PGSIZE, sizeof mark);
+      if (mark != r)
+        fail ("Page %zu of a run was overwritten.", i);
+    }
+  palloc_free_multiple (r->pages, r->cnt);
+  r->pages = NULL;
+}
+
+/* Returns the largest number of contiguous pages that can be
+   allocated from the user pool, found by binary search. */
+static size_t
+largest_run (void) 
+{
+  size_t lo = 0, hi = 1;
+
+  for (;;) 
+    {
+      void *pages = palloc_get_multiple (PAL_USER, hi);
+      if (pages == NULL)
+        break;
+      palloc_free_multiple (pages, hi);
+      lo = hi;
+      hi *= 2;
+    }
+  while (hi - lo > 1) 
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      void *pages = palloc_get_multiple (PAL_USER, mid);
+      if (pages != NULL) 
+        {
+          palloc_free_multiple (pages, mid);
+          lo = mid;
+        }
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Returns the number of free pages in the user pool, by
+   allocating them all and freeing them again.  The pages are
+   chained through their first words. */
+static size_t
+free_pages (void) 
+{
+  void *head = NULL;
+  void *page;
+  size_t cnt = 0;
+
+  while ((page = palloc_get_page (PAL_USER)) != NULL) 
+    {
+      *(void **) page = head;
+      head = page;
+      cnt++;
+    }
+  while (head != NULL) 
+    {
+      page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+  return cnt;
+}
+
+/* Returns CNT rounded up to a power of 2, the size of the buddy
+   block that a run of CNT pages comes from. */
+static size_t
+block_pages (size_t cnt) 
+{
+  size_t size = 1;
+
+  while (size < cnt)
+    size *= 2;
+  return size;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(palloc-bench) begin
+(palloc-bench) No allocations overlapped.
+(palloc-bench) Every run was aligned to its block size.
+(palloc-bench) Freed runs merged back together.
+(palloc-bench) end
+EOF
+pass;
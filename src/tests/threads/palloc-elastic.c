@@ -0,0 +1,111 @@
+/* Checks that the kernel and user pools share memory.  Fills a
+   stash of kernel pages, then allocates user pages until none
+   are left, which should make the page allocator call our
+   reclaim function to give back the stash, and should still
+   leave the kernel its reserve.  Then checks that once the user
+   pages are freed, the kernel can allocate more pages than it
+   could while they were in use. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+
+/* Kernel pages to stash for reclaim_stash() to give back. */
+#define STASH_PAGES 256
+
+/* Kernel pages that must remain available with user memory
+   exhausted. */
+#define RESERVE_PAGES 16
+
+static void *stash[STASH_PAGES];
+static int reclaim_calls;
+
+static size_t reclaim_stash (void);
+static void *alloc_all (enum palloc_flags, size_t *cnt);
+static void free_all (void *head);
+
+void
+test_palloc_elastic (void) 
+{
+  void *user_head, *kernel_head;
+  size_t user_cnt, kernel_cnt, kernel_cnt_after;
+  int i;
+
+  for (i = 0; i < STASH_PAGES; i++) 
+    {
+      stash[i] = palloc_get_page (0);
+      if (stash[i] == NULL)
+        fail ("Could not fill stash.");
+    }
+  palloc_register_reclaim (reclaim_stash);
+
+  user_head = alloc_all (PAL_USER, &user_cnt);
+  if (reclaim_calls == 0)
+    fail ("Reclaim function not called with %zu user pages in use.",
+          user_cnt);
+  msg ("Kernel caches were asked to shrink.");
+
+  kernel_head = alloc_all (0, &kernel_cnt);
+  if (kernel_cnt < RESERVE_PAGES)
+    fail ("Only %zu kernel pages left with user memory exhausted.",
+          kernel_cnt);
+  msg ("Kernel reserve survived user exhaustion.");
+  free_all (kernel_head);
+
+  free_all (user_head);
+  kernel_head = alloc_all (0, &kernel_cnt_after);
+  free_all (kernel_head);
+  if (kernel_cnt_after <= kernel_cnt)
+    fail ("Kernel got %zu pages after user memory was freed, "
+          "%zu before.", kernel_cnt_after, kernel_cnt);
+  msg ("Kernel pool grew into memory freed by user pool.");
+}
+
+/* Reclaim function: frees the stash, if it is still full. */
+static size_t
+reclaim_stash (void) 
+{
+  int i;
+
+  reclaim_calls++;
+  if (stash[0] == NULL)
+    return 0;
+  for (i = 0; i < STASH_PAGES; i++) 
+    {
+      palloc_free_page (stash[i]);
+      stash[i] = NULL;
+    }
+  return STASH_PAGES;
+}
+
+/* Allocates pages with FLAGS until none are left, chaining them
+   through their first words.  Stores the number of pages
+   allocated in *CNT and returns the first. */
+static void *
+alloc_all (enum palloc_flags flags, size_t *cnt) 
+{
+  void *head = NULL;
+  void *page;
+
+  *cnt = 0;
+  while ((page = palloc_get_page (flags)) != NULL) 
+    {
+      *(void **) page = head;
+      head = page;
+      ++*cnt;
+    }
+  return head;
+}
+
+/* Frees the chain of pages starting at HEAD. */
+static void
+free_all (void *head) 
+{
+  while (head != NULL) 
+    {
+      void *page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+}
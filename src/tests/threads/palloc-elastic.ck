@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(palloc-elastic) begin
+(palloc-elastic) Kernel caches were asked to shrink.
+(palloc-elastic) Kernel reserve survived user exhaustion.
+(palloc-elastic) Kernel pool grew into memory freed by user pool.
+(palloc-elastic) end
+EOF
+pass;
@@ -0,0 +1,128 @@
+/* Checks that the idle thread keeps pre-zeroed pages for
+   PAL_ZERO requests.  Sleeps so that the idle thread can zero
+   pages, then times PAGES single-page PAL_ZERO allocations from
+   the user pool that should be served from the pre-zeroed list,
+   and PAGES more after the list has been emptied, which need a
+   memset.  Checks that every page is zero either way, and that
+   the idle thread refills the list once the pages are freed. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define PAGES 16                /* Pages allocated in each pass. */
+
+static void *hit_pages[PAGES];
+static void *miss_pages[PAGES];
+
+static int64_t alloc_pages (void *pages[]);
+static void check_zero (const void *page);
+
+void
+test_palloc_zero (void) 
+{
+  struct palloc_zero_stats before, after;
+  int64_t hit_ns, miss_ns;
+  void *head = NULL;
+  void *page;
+  int i;
+
+  /* Have the user pool borrow memory, which it keeps after the
+     page is freed, and give the idle thread time to zero it. */
+  palloc_free_page (palloc_get_page (PAL_USER));
+  timer_msleep (100);
+  palloc_zero_stats (PAL_USER, &before);
+  if (before.zeroed_cnt < PAGES)
+    fail ("Only %zu pre-zeroed pages after sleeping.", before.zeroed_cnt);
+
+  hit_ns = alloc_pages (hit_pages);
+  palloc_zero_stats (PAL_USER, &after);
+  if (after.hits - before.hits != PAGES)
+    fail ("%"PRIu64" of %d pages were pre-zeroed.",
+          after.hits - before.hits, PAGES);
+  msg ("Pre-zeroed pages were used.");
+
+  /* Empty the pre-zeroed list.  The pages are chained through
+     their first words. */
+  while (after.zeroed_cnt > 0) 
+    {
+      page = palloc_get_page (PAL_USER | PAL_ZERO);
+      check_zero (page);
+      *(void **) page = head;
+      head = page;
+      palloc_zero_stats (PAL_USER, &after);
+    }
+
+  before = after;
+  miss_ns = alloc_pages (miss_pages);
+  palloc_zero_stats (PAL_USER, &after);
+  if (after.misses - before.misses != PAGES)
+    fail ("%"PRIu64" of %d pages needed memset.",
+          after.misses - before.misses, PAGES);
+  msg ("Pages were zeroed on demand after the list ran out.");
+
+  for (i = 0; i < PAGES; i++) 
+    {
+      palloc_free_page (hit_pages[i]);
+      palloc_free_page (miss_pages[i]);
+    }
+  while (head != NULL) 
+    {
+      page = head;
+      head = *(void **) page;
+      palloc_free_page (page);
+    }
+
+  /* Freed pages are dirty, so only the idle thread can put them
+     back on the list. */
+  before = after;
+  timer_msleep (100);
+  palloc_zero_stats (PAL_USER, &after);
+  if (after.zeroed_cnt < PAGES || after.idle_zeroed <= before.idle_zeroed)
+    fail ("Idle thread zeroed %"PRIu64" pages, leaving %zu pre-zeroed.",
+          after.idle_zeroed - before.idle_zeroed, after.zeroed_cnt);
+  msg ("Idle thread refilled the list.");
+
+  report ("Pre-zeroed page: %"PRId64" ns.", hit_ns / PAGES);
+  report ("Page zeroed on demand: %"PRId64" ns.", miss_ns / PAGES);
+}
+
+/* Allocates PAGES zeroed user pages into PAGES[], checks that
+   they are zero, and returns the time taken to allocate them. */
+static int64_t
+alloc_pages (void *pages[]) 
+{
+  int64_t start = timer_ns ();
+  int64_t elapsed;
+  int i;
+
+  for (i = 0; i < PAGES; i++) 
+    {
+      pages[i] = palloc_get_page (PAL_USER | PAL_ZERO);
+      if (pages[i] == NULL)
+        fail ("palloc_get_page() failed.");
+    }
+  elapsed = timer_ns () - start;
+
+  for (i = 0; i < PAGES; i++)
+    check_zero (pages[i]);
+  return elapsed;
+}
+
+/* Fails unless PAGE is all zeros. */
+static void
+check_zero (const void *page) 
+{
+  const uint32_t *p = page;
+  size_t i;
+
+  if (p == NULL)
+    fail ("palloc_get_page() failed.");
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      fail ("Word %zu of a PAL_ZERO page is %#"PRIx32".", i, p[i]);
+}
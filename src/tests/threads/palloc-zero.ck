@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(palloc-zero) begin
+(palloc-zero) Pre-zeroed pages were used.
+(palloc-zero) Pages were zeroed on demand after the list ran out.
+(palloc-zero) Idle thread refilled the list.
+(palloc-zero) end
+EOF
+pass;
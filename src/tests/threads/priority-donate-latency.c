@@ -0,0 +1,138 @@
+/* Measures how long a high-priority thread waits for a lock held
+   by a low-priority thread while several CPU-bound threads of
+   intermediate priority are ready to run.
+
+   Each iteration, a low-priority thread acquires the lock and
+   needs LOW_HOLD_TICKS of CPU time to finish its critical
+   section.  MEDIUM_CNT medium-priority threads each want
+   MEDIUM_SPIN_TICKS of CPU time.  Then a high-priority thread
+   tries to acquire the lock.  With priority donation, the low
+   thread runs at high priority until it releases the lock, so
+   the high thread waits about LOW_HOLD_TICKS; without it, the
+   high thread also waits for all the medium threads. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 10
+#define MEDIUM_CNT 3
+#define LOW_HOLD_TICKS 3
+#define MEDIUM_SPIN_TICKS 20
+
+/* State shared by the threads in one iteration. */
+struct latency_test 
+  {
+    struct lock lock;                   /* Lock being contended. */
+    struct semaphore go;                /* Starts the workers. */
+    struct semaphore done;              /* Upped by each exiting worker. */
+    int64_t wait;                       /* High thread's wait, in ticks. */
+  };
+
+static thread_func low_thread_func;
+static thread_func medium_thread_func;
+static thread_func high_thread_func;
+
+static void spin (int64_t ticks);
+
+void
+test_priority_donate_latency (void) 
+{
+  int64_t max_wait = 0, total_wait = 0;
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  msg ("Running %d iterations with %d medium-priority threads.",
+       ITERATIONS, MEDIUM_CNT);
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      struct latency_test test;
+
+      lock_init (&test.lock);
+      sema_init (&test.go, 0);
+      sema_init (&test.done, 0);
+
+      /* The low thread preempts us, takes the lock, and waits
+         for the go signal. */
+      thread_create ("low", PRI_DEFAULT + 1, low_thread_func, &test);
+
+      /* Create the rest without letting any of them run. */
+      thread_set_priority (PRI_MAX);
+      for (j = 0; j < MEDIUM_CNT; j++)
+        thread_create ("medium", PRI_DEFAULT + 10, medium_thread_func, &test);
+      thread_create ("high", PRI_DEFAULT + 20, high_thread_func, &test);
+
+      for (j = 0; j < MEDIUM_CNT + 2; j++)
+        sema_up (&test.go);
+      for (j = 0; j < MEDIUM_CNT + 2; j++)
+        sema_down (&test.done);
+      thread_set_priority (PRI_DEFAULT);
+
+      if (test.wait > max_wait)
+        max_wait = test.wait;
+      total_wait += test.wait;
+    }
+
+  msg ("High thread waited at most %"PRId64" ticks, "
+       "%"PRId64" ticks in total.", max_wait, total_wait);
+  if (max_wait >= MEDIUM_SPIN_TICKS)
+    fail ("high thread waited behind medium-priority threads");
+  msg ("High thread never waited behind medium-priority threads.");
+}
+
+/* Holds the lock for LOW_HOLD_TICKS of CPU time. */
+static void
+low_thread_func (void *test_) 
+{
+  struct latency_test *test = test_;
+
+  lock_acquire (&test->lock);
+  sema_down (&test->go);
+  spin (LOW_HOLD_TICKS);
+  lock_release (&test->lock);
+  sema_up (&test->done);
+}
+
+/* Uses MEDIUM_SPIN_TICKS of CPU time. */
+static void
+medium_thread_func (void *test_) 
+{
+  struct latency_test *test = test_;
+
+  sema_down (&test->go);
+  spin (MEDIUM_SPIN_TICKS);
+  sema_up (&test->done);
+}
+
+/* Measures how long it takes to acquire the lock. */
+static void
+high_thread_func (void *test_) 
+{
+  struct latency_test *test = test_;
+  int64_t start;
+
+  sema_down (&test->go);
+  start = timer_ticks ();
+  lock_acquire (&test->lock);
+  test->wait = timer_elapsed (start);
+  lock_release (&test->lock);
+  sema_up (&test->done);
+}
+
+/* Busy-waits for TICKS timer ticks. */
+static void
+spin (int64_t ticks) 
+{
+  int64_t start = timer_ticks ();
+  while (timer_elapsed (start) < ticks)
+    continue;
+}
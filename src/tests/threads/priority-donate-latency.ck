@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = get_core_output ("run", @output);
+
+local ($_);
+my ($max_wait);
+foreach (@output) {
+    ($max_wait) = /High thread waited at most (\d+) ticks/ and last;
+}
+fail "Wait time missing from output.\n" if !defined $max_wait;
+fail "High thread waited $max_wait ticks behind medium threads.\n"
+  if $max_wait >= 20;
+pass;
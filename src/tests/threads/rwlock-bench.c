@@ -0,0 +1,216 @@
+/* Measures the cost of acquiring and releasing a readers-writer
+   lock, without contention and with READER_CNT readers and
+   WRITER_CNT writers competing for it, and compares the
+   uncontended read path with struct lock.  While contending,
+   the threads check that readers and writers exclude each
+   other and that readers share the lock.  Finally checks that a
+   waiting writer goes ahead of a reader that arrives after it.
+
+   To create contention on a single CPU, each thread yields
+   while holding the lock every YIELD_EVERY iterations, so that
+   the others find it held. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 10000        /* Uncontended acquire/release pairs. */
+#define READER_CNT 4            /* Contending readers. */
+#define WRITER_CNT 2            /* Contending writers. */
+#define OPS_PER_THREAD 2000     /* Acquire/release pairs per thread. */
+#define YIELD_EVERY 16          /* Yield inside every Nth section. */
+
+/* State shared by the contending threads. */
+struct rwlock_test 
+  {
+    struct rwlock rw;           /* Lock under test. */
+    struct semaphore done;      /* Upped by each exiting thread. */
+    int readers;                /* Readers inside the lock. */
+    int max_readers;            /* Most readers inside at once. */
+    int writers;                /* Writers inside the lock. */
+    bool violation;             /* Did exclusion fail? */
+  };
+
+/* State for checking the order in which waiters get the lock. */
+struct order_test 
+  {
+    struct rwlock rw;           /* Lock under test. */
+    struct semaphore done;      /* Upped by each exiting thread. */
+    char order[3];              /* "w" or "r" per acquisition. */
+    int cnt;                    /* Number of acquisitions. */
+  };
+
+static thread_func reader_func;
+static thread_func writer_func;
+static thread_func order_reader_func;
+static thread_func order_writer_func;
+static void check_order (void);
+
+void
+test_rwlock_bench (void) 
+{
+  struct rwlock_test test;
+  struct lock lock;
+  int64_t start, read_ns, write_ns, lock_ns, contended_ns;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  rwlock_init (&test.rw);
+  lock_init (&lock);
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      rwlock_acquire_read (&test.rw);
+      rwlock_release_read (&test.rw);
+    }
+  read_ns = timer_ns () - start;
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      rwlock_acquire_write (&test.rw);
+      rwlock_release_write (&test.rw);
+    }
+  write_ns = timer_ns () - start;
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      lock_acquire (&lock);
+      lock_release (&lock);
+    }
+  lock_ns = timer_ns () - start;
+
+  report ("Uncontended rwlock read: %"PRId64" ns per acquire/release.",
+          read_ns / ITERATIONS);
+  report ("Uncontended rwlock write: %"PRId64" ns per acquire/release.",
+          write_ns / ITERATIONS);
+  report ("Uncontended lock: %"PRId64" ns per acquire/release.",
+          lock_ns / ITERATIONS);
+
+  sema_init (&test.done, 0);
+  test.readers = test.max_readers = test.writers = 0;
+  test.violation = false;
+  start = timer_ns ();
+  for (i = 0; i < READER_CNT; i++)
+    thread_create ("reader", PRI_DEFAULT, reader_func, &test);
+  for (i = 0; i < WRITER_CNT; i++)
+    thread_create ("writer", PRI_DEFAULT, writer_func, &test);
+  for (i = 0; i < READER_CNT + WRITER_CNT; i++)
+    sema_down (&test.done);
+  contended_ns = timer_ns () - start;
+
+  report ("Contended rwlock, %d readers and %d writers: "
+          "%"PRId64" ns per acquire/release.", READER_CNT, WRITER_CNT,
+          contended_ns / ((READER_CNT + WRITER_CNT) * OPS_PER_THREAD));
+  if (test.violation)
+    fail ("readers and writers held the lock at the same time");
+  msg ("Readers and writers excluded each other.");
+  if (test.max_readers < 2)
+    fail ("At most %d reader held the lock at once.", test.max_readers);
+  msg ("Readers shared the lock.");
+
+  check_order ();
+}
+
+/* Holds a rwlock for reading while a writer and then a reader
+   start waiting for it, and checks that releasing it lets the
+   writer in first. */
+static void
+check_order (void) 
+{
+  struct order_test test;
+
+  rwlock_init (&test.rw);
+  sema_init (&test.done, 0);
+  test.cnt = 0;
+
+  /* Each thread preempts us and blocks on the lock. */
+  rwlock_acquire_read (&test.rw);
+  thread_create ("writer", PRI_DEFAULT + 1, order_writer_func, &test);
+  thread_create ("reader", PRI_DEFAULT + 1, order_reader_func, &test);
+  if (test.cnt != 0)
+    fail ("A thread got the lock while another reader held it "
+          "with a writer waiting.");
+  rwlock_release_read (&test.rw);
+  sema_down (&test.done);
+  sema_down (&test.done);
+
+  test.order[test.cnt] = '\0';
+  if (strcmp (test.order, "wr"))
+    fail ("Waiters got the lock in order \"%s\", not \"wr\".",
+          test.order);
+  msg ("A waiting writer went ahead of a later reader.");
+}
+
+static void
+reader_func (void *test_) 
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < OPS_PER_THREAD; i++) 
+    {
+      rwlock_acquire_read (&test->rw);
+      if (++test->readers > test->max_readers)
+        test->max_readers = test->readers;
+      if (test->writers != 0)
+        test->violation = true;
+      if (i % YIELD_EVERY == 0)
+        thread_yield ();
+      test->readers--;
+      rwlock_release_read (&test->rw);
+    }
+  sema_up (&test->done);
+}
+
+static void
+writer_func (void *test_) 
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < OPS_PER_THREAD; i++) 
+    {
+      rwlock_acquire_write (&test->rw);
+      test->writers++;
+      if (test->writers != 1 || test->readers != 0
+          || !rwlock_held_for_write (&test->rw))
+        test->violation = true;
+      if (i % YIELD_EVERY == 0)
+        thread_yield ();
+      test->writers--;
+      rwlock_release_write (&test->rw);
+    }
+  sema_up (&test->done);
+}
+
+static void
+order_reader_func (void *test_) 
+{
+  struct order_test *test = test_;
+
+  rwlock_acquire_read (&test->rw);
+  test->order[test->cnt++] = 'r';
+  rwlock_release_read (&test->rw);
+  sema_up (&test->done);
+}
+
+static void
+order_writer_func (void *test_) 
+{
+  struct order_test *test = test_;
+
+  rwlock_acquire_write (&test->rw);
+  test->order[test->cnt++] = 'w';
+  rwlock_release_write (&test->rw);
+  sema_up (&test->done);
+}
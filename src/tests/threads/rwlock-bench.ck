@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(rwlock-bench) begin
+(rwlock-bench) Readers and writers excluded each other.
+(rwlock-bench) Readers shared the lock.
+(rwlock-bench) A waiting writer went ahead of a later reader.
+(rwlock-bench) end
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Has the main thread and another thread of equal priority yield
+   to each other, then checks that the per-thread switch counts
+   and the scheduler trace both record the hand-offs. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/sched-trace.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Number of times each thread yields. */
+#define YIELD_CNT 10
+
+static thread_func yielder;
+
+void
+test_sched_trace (void) 
+{
+  struct thread *cur = thread_current ();
+  struct semaphore done;
+  struct sched_event *events;
+  unsigned invol_before, vol_before;
+  size_t cnt, i;
+  tid_t tid;
+  int handoffs;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  events = malloc (sizeof *events * SCHED_TRACE_SIZE);
+  if (events == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  invol_before = cur->invol_switches;
+  vol_before = cur->vol_switches;
+
+  msg ("Yielding back and forth %d times.", YIELD_CNT);
+  sema_init (&done, 0);
+  tid = thread_create ("yielder", PRI_DEFAULT, yielder, &done);
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  sema_down (&done);
+
+  if (cur->invol_switches - invol_before < YIELD_CNT)
+    fail ("only %u involuntary switches counted",
+          cur->invol_switches - invol_before);
+  msg ("Involuntary switches counted.");
+  if (cur->vol_switches == vol_before)
+    fail ("blocking on the semaphore was not counted");
+  msg ("Voluntary switch counted.");
+
+  cnt = sched_trace_read (events, SCHED_TRACE_SIZE);
+  handoffs = 0;
+  for (i = 0; i < cnt; i++)
+    {
+      if (i > 0 && events[i].time < events[i - 1].time)
+        fail ("trace timestamps go backward");
+      if (events[i].prev == cur->tid && events[i].next == tid
+          && events[i].prev_status == THREAD_READY)
+        handoffs++;
+    }
+  if (handoffs < YIELD_CNT)
+    fail ("trace shows only %d hand-offs to yielder", handoffs);
+  msg ("Trace shows the hand-offs.");
+
+  free (events);
+}
+
+static void
+yielder (void *done_) 
+{
+  struct semaphore *done = done_;
+  int i;
+
+  for (i = 0; i < YIELD_CNT; i++)
+    thread_yield ();
+  sema_up (done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sched-trace) begin
+(sched-trace) Yielding back and forth 10 times.
+(sched-trace) Involuntary switches counted.
+(sched-trace) Voluntary switch counted.
+(sched-trace) Trace shows the hand-offs.
+(sched-trace) end
+EOF
+pass;
@@ -0,0 +1,141 @@
+/* Checks that a read overlapping a write must be retried, then
+   measures the cost of reading a 64-bit counter under a sequence
+   lock, as timer_ticks() does, against reading it with
+   interrupts disabled.  Then has a high-resolution timer update
+   a pair of values under a seqlock every WRITE_INTERVAL_NS from
+   interrupt context while this thread keeps reading the pair,
+   and checks that no torn read is ever accepted and that the
+   reader sees the writer's updates. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 100000       /* Reads timed in each mode. */
+#define WRITE_INTERVAL_NS 100000 /* Time between writes. */
+#define READ_TICKS 20           /* Duration of the concurrent phase. */
+
+/* Pair of values that the writer keeps equal. */
+static struct seqlock pair_lock;
+static volatile uint32_t pair_a, pair_b;
+static volatile bool stop;
+static int write_cnt;
+
+static void writer (struct hrtimer *);
+
+void
+test_seqlock_bench (void) 
+{
+  struct seqlock sl;
+  struct hrtimer timer;
+  int64_t counter = 0, sum = 0;
+  int64_t start, seq_ns, intr_ns, end_tick;
+  long long reads = 0, retries = 0, torn = 0, changes = 0;
+  uint32_t last_a = 0;
+  enum intr_level old_level;
+  unsigned seq;
+  int i;
+
+  seqlock_init (&sl);
+  seq = seqlock_read_begin (&sl);
+  old_level = seqlock_write_begin (&sl);
+  seqlock_write_end (&sl, old_level);
+  if (!seqlock_read_retry (&sl, seq))
+    fail ("Read overlapping a write was not retried.");
+  seq = seqlock_read_begin (&sl);
+  if (seqlock_read_retry (&sl, seq))
+    fail ("Read with no write in progress was retried.");
+  msg ("Reads overlapping a write are retried.");
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      unsigned seq;
+      int64_t value;
+
+      do 
+        {
+          seq = seqlock_read_begin (&sl);
+          value = counter;
+        }
+      while (seqlock_read_retry (&sl, seq));
+      sum += value;
+    }
+  seq_ns = timer_ns () - start;
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      enum intr_level old_level = intr_disable ();
+      sum += counter;
+      intr_set_level (old_level);
+    }
+  intr_ns = timer_ns () - start;
+
+  report ("seqlock read: %"PRId64" ps per read.",
+          seq_ns * 1000 / ITERATIONS);
+  report ("Interrupts-off read: %"PRId64" ps per read.",
+          intr_ns * 1000 / ITERATIONS);
+
+  /* Contend with a writer in interrupt context. */
+  seqlock_init (&pair_lock);
+  hrtimer_init (&timer, writer, NULL);
+  hrtimer_start (&timer, timer_ns () + WRITE_INTERVAL_NS);
+  end_tick = timer_ticks () + READ_TICKS;
+  while (timer_ticks () < end_tick) 
+    {
+      uint32_t a, b;
+
+      for (;;)
+        {
+          seq = seqlock_read_begin (&pair_lock);
+          a = pair_a;
+          b = pair_b;
+          if (!seqlock_read_retry (&pair_lock, seq))
+            break;
+          retries++;
+        }
+      if (a != b)
+        torn++;
+      if (a != last_a)
+        changes++;
+      last_a = a;
+      reads++;
+    }
+  stop = true;
+  hrtimer_cancel (&timer);
+
+  report ("%lld reads during %d writes, %lld retried.",
+          reads, write_cnt, retries);
+  if (torn != 0)
+    fail ("%lld torn reads accepted", torn);
+  msg ("No torn reads accepted.");
+  if (write_cnt == 0)
+    fail ("Writer never ran.");
+  if (changes == 0 || changes > write_cnt)
+    fail ("Reader saw %lld changes during %d writes.", changes, write_cnt);
+  if (pair_a != (uint32_t) write_cnt || pair_b != pair_a)
+    fail ("Pair is %"PRIu32", %"PRIu32" after %d writes.",
+          pair_a, pair_b, write_cnt);
+  msg ("Reader saw the writer's updates.");
+}
+
+/* Updates the pair, then rearms itself unless told to stop. */
+static void
+writer (struct hrtimer *t) 
+{
+  enum intr_level old_level = seqlock_write_begin (&pair_lock);
+  pair_a++;
+  barrier ();
+  pair_b = pair_a;
+  seqlock_write_end (&pair_lock, old_level);
+  write_cnt++;
+
+  if (!stop)
+    hrtimer_start (t, t->expires + WRITE_INTERVAL_NS);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(seqlock-bench) begin
+(seqlock-bench) Reads overlapping a write are retried.
+(seqlock-bench) No torn reads accepted.
+(seqlock-bench) Reader saw the writer's updates.
+(seqlock-bench) end
+EOF
+pass;
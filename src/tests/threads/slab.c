@@ -0,0 +1,89 @@
+/* Allocates enough objects from a slab cache to fill several
+   slabs, checks that they do not overlap and that the
+   constructor ran once per object, then frees them all and
+   checks that reallocating them reuses the same objects without
+   constructing them again. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+#include "threads/vaddr.h"
+
+#define OBJ_CNT 100             /* Objects to allocate. */
+
+/* An object a little over a power of 2 in size, which malloc()
+   would round up to twice that. */
+struct obj 
+  {
+    struct obj *self;           /* Set by the constructor. */
+    char data[257];             /* Marked with the object's index. */
+  };
+
+static int ctor_cnt;
+static slab_ctor_func obj_ctor;
+
+void
+test_slab (void) 
+{
+  static struct slab_cache cache;
+  struct obj *objs[OBJ_CNT];
+  int i, j;
+
+  slab_cache_init (&cache, "test", sizeof (struct obj), 0, obj_ctor);
+  if (cache.objs_per_slab <= PGSIZE / 512)
+    fail ("%zu objects per slab is no better than malloc().",
+          cache.objs_per_slab);
+
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = slab_alloc (&cache);
+      if (objs[i] == NULL)
+        fail ("slab_alloc() failed after %d objects.", i);
+      if (objs[i]->self != objs[i])
+        fail ("Object %d was not constructed.", i);
+      memset (objs[i]->data, i, sizeof objs[i]->data);
+    }
+  for (i = 0; i < OBJ_CNT; i++)
+    for (j = 0; j < (int) sizeof objs[i]->data; j++)
+      if (objs[i]->data[j] != (char) i)
+        fail ("Object %d was overwritten.", i);
+  if (cache.in_use != OBJ_CNT)
+    fail ("%zu objects counted in use, expected %d.",
+          cache.in_use, OBJ_CNT);
+  msg ("Allocated %d objects.", OBJ_CNT);
+
+  for (i = 0; i < OBJ_CNT; i++)
+    slab_free (&cache, objs[i]);
+  if (cache.in_use != 0)
+    fail ("%zu objects still counted in use.", cache.in_use);
+
+  /* The empty slabs that were kept are used again first. */
+  for (i = 0; i < OBJ_CNT; i++) 
+    {
+      objs[i] = slab_alloc (&cache);
+      if (objs[i] == NULL || objs[i]->self != objs[i])
+        fail ("Reallocated object %d is not constructed.", i);
+    }
+  if (ctor_cnt != (int) (cache.slab_alloc_cnt * cache.objs_per_slab))
+    fail ("Constructor ran %d times for %zu slabs' objects.",
+          ctor_cnt, (size_t) cache.slab_alloc_cnt);
+  for (i = 0; i < OBJ_CNT; i++)
+    slab_free (&cache, objs[i]);
+  msg ("Objects were constructed once per slab allocation.");
+
+  slab_reclaim ();
+  if (cache.slab_cnt != 0)
+    fail ("%zu slabs left after reclaim.", cache.slab_cnt);
+  msg ("Reclaim freed every slab.");
+}
+
+static void
+obj_ctor (void *obj_) 
+{
+  struct obj *obj = obj_;
+
+  obj->self = obj;
+  ctor_cnt++;
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab) begin
+(slab) Allocated 100 objects.
+(slab) Objects were constructed once per slab allocation.
+(slab) Reclaim freed every slab.
+(slab) end
+EOF
+pass;
@@ -0,0 +1,93 @@
+/* Raises a softirq from a high-resolution timer and checks that
+   its handler runs to completion in interrupt context with
+   interrupts on.  While it runs, the handler turns interrupts off
+   and back on, as code it calls may do, and waits for a second
+   timer, which checks that external interrupts nest inside
+   softirqs.  The second timer raises another softirq, which must
+   wait until the first handler returns and then run in the same
+   softirq loop. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static struct semaphore done;
+static struct hrtimer outer, inner;
+static int first_nr, second_nr;
+
+/* Set by interrupt and softirq handlers, read by the test. */
+static bool inner_fired;
+static bool first_done;
+static const char *error;
+
+static void raise_first (struct hrtimer *);
+static void raise_second (struct hrtimer *);
+static void first_softirq (void);
+static void second_softirq (void);
+
+void
+test_softirq_nest (void)
+{
+  sema_init (&done, 0);
+  first_nr = softirq_register (first_softirq, "first");
+  second_nr = softirq_register (second_softirq, "second");
+  hrtimer_init (&outer, raise_first, NULL);
+  hrtimer_init (&inner, raise_second, NULL);
+  hrtimer_start (&outer, timer_ns () + 1000000);
+  sema_down (&done);
+
+  if (error != NULL)
+    fail ("%s", error);
+  msg ("First softirq ran with interrupts on, in interrupt context.");
+  msg ("Timer interrupt nested inside the first softirq.");
+  msg ("Second softirq ran after the first one returned.");
+}
+
+/* Timer interrupt: raise the first softirq. */
+static void
+raise_first (struct hrtimer *t UNUSED)
+{
+  softirq_raise (first_nr);
+}
+
+/* Timer interrupt, nested in the first softirq: raise the second
+   softirq. */
+static void
+raise_second (struct hrtimer *t UNUSED)
+{
+  inner_fired = true;
+  softirq_raise (second_nr);
+}
+
+/* First softirq: check the context, toggle interrupts, and wait
+   for a nested timer interrupt. */
+static void
+first_softirq (void)
+{
+  enum intr_level old_level;
+
+  if (!intr_context () || intr_get_level () != INTR_ON)
+    error = "softirq ran outside interrupt context or with interrupts off";
+
+  old_level = intr_disable ();
+  intr_set_level (old_level);
+
+  hrtimer_start (&inner, timer_ns () + 1000000);
+  while (!inner_fired)
+    barrier ();
+  first_done = true;
+}
+
+/* Second softirq: check that the first one finished, then wake
+   up the test. */
+static void
+second_softirq (void)
+{
+  if (!first_done)
+    error = "second softirq ran inside the first";
+  sema_up (&done);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(softirq-nest) begin
+(softirq-nest) First softirq ran with interrupts on, in interrupt context.
+(softirq-nest) Timer interrupt nested inside the first softirq.
+(softirq-nest) Second softirq ran after the first one returned.
+(softirq-nest) end
+EOF
+pass;
@@ -0,0 +1,85 @@
+/* Measures how long it takes to create a thread that runs and
+   exits at once, over ITERATIONS threads, and checks that they
+   all ran and had distinct tids, and that the pages of exited
+   threads were reused: since each child exits before the next
+   is created, a handful of pages should serve them all.
+   For comparison, also measures allocating and freeing a zeroed
+   page, which is what every thread_create() used to cost before
+   its thread struct and stack came from the thread cache. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define ITERATIONS 1000         /* Threads to spawn. */
+#define PAGES_MAX 8             /* Most distinct thread pages allowed. */
+
+/* Distinct pages that children ran in. */
+static struct thread *pages[PAGES_MAX];
+static int page_cnt;
+
+static thread_func child_func;
+
+void
+test_spawn_bench (void) 
+{
+  tid_t last_tid = TID_ERROR;
+  int64_t start, spawn_ns, page_ns;
+  int ran = 0;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Each child preempts us, runs, and exits before
+     thread_create() returns. */
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      tid_t tid = thread_create ("child", PRI_DEFAULT + 1, child_func, &ran);
+      if (tid == TID_ERROR)
+        fail ("thread_create() failed after %d threads.", i);
+      if (tid <= last_tid)
+        fail ("tid %d follows tid %d.", tid, last_tid);
+      last_tid = tid;
+    }
+  spawn_ns = timer_ns () - start;
+  if (ran != ITERATIONS)
+    fail ("%d of %d threads ran.", ran, ITERATIONS);
+  msg ("All %d threads ran, with increasing tids.", ITERATIONS);
+  msg ("Children ran in at most %d different pages.", PAGES_MAX);
+
+  start = timer_ns ();
+  for (i = 0; i < ITERATIONS; i++) 
+    {
+      void *page = palloc_get_page (PAL_ZERO);
+      if (page == NULL)
+        fail ("palloc_get_page() failed.");
+      palloc_free_page (page);
+    }
+  page_ns = timer_ns () - start;
+
+  report ("Spawning a thread: %"PRId64" ns.", spawn_ns / ITERATIONS);
+  report ("Allocating a zeroed page: %"PRId64" ns.",
+          page_ns / ITERATIONS);
+}
+
+static void
+child_func (void *ran_) 
+{
+  struct thread *t = thread_current ();
+  int *ran = ran_;
+  int i;
+
+  (*ran)++;
+  for (i = 0; i < page_cnt; i++)
+    if (pages[i] == t)
+      return;
+  if (page_cnt >= PAGES_MAX)
+    fail ("Children ran in more than %d different pages.", PAGES_MAX);
+  pages[page_cnt++] = t;
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_REPORTS => 1, [<<'EOF']);
+(spawn-bench) begin
+(spawn-bench) All 1000 threads ran, with increasing tids.
+(spawn-bench) Children ran in at most 8 different pages.
+(spawn-bench) end
+EOF
+pass;
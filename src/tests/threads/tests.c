@@ -17,6 +17,12 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-idle", test_alarm_idle},
+    {"alarm-nsleep", test_alarm_nsleep},
+    {"hrtimer-rearm", test_hrtimer_rearm},
+    {"alarm-tickless", test_alarm_tickless},
+    {"alarm-idle-tickless", test_alarm_idle},
+    {"alarm-multiple-tickless", test_alarm_multiple},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,6 +31,26 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-latency", test_priority_donate_latency},
+    {"sched-trace", test_sched_trace},
+    {"workqueue", test_workqueue},
+    {"softirq-nest", test_softirq_nest},
+    {"rwlock-bench", test_rwlock_bench},
+    {"seqlock-bench", test_seqlock_bench},
+    {"completion-bench", test_completion_bench},
+    {"lockstat", test_lockstat},
+    {"spawn-bench", test_spawn_bench},
+    {"edf-admit", test_edf_admit},
+    {"edf-mixed", test_edf_mixed},
+    {"intr-stat", test_intr_stat},
+    {"palloc-bench", test_palloc_bench},
+    {"slab", test_slab},
+    {"malloc-bench", test_malloc_bench},
+    {"malloc-mag", test_malloc_mag},
+    {"palloc-zero", test_palloc_zero},
+    {"large-page", test_large_page},
+    {"palloc-elastic", test_palloc_elastic},
+    {"kmem-stat", test_kmem_stat},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
@@ -38,6 +64,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-tick-work", test_mlfqs_tick_work},
+    {"mlfqs-edf", test_mlfqs_edf},
   };
 
 static const char *test_name;
@@ -75,6 +103,21 @@ msg (const char *format, ...)
   putchar ('\n');
 }
 
+/* Prints FORMAT like msg(), but marked as a report of something
+   that varies from run to run, such as a timing, which the .ck
+   files do not compare. */
+void
+report (const char *format, ...) 
+{
+  va_list args;
+  
+  printf ("(%s) report: ", test_name);
+  va_start (args, format);
+  vprintf (format, args);
+  va_end (args);
+  putchar ('\n');
+}
+
 /* Prints failure message FORMAT as if with printf(),
    prefixing the output by the name of the test and FAIL:
    and following it with a new-line character,
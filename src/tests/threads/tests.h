@@ -11,6 +11,10 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_idle;
+extern test_func test_alarm_nsleep;
+extern test_func test_hrtimer_rearm;
+extern test_func test_alarm_tickless;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -19,6 +23,26 @@ extern test_func test_priority_donate_sema;
 extern test_func test_priority_donate_nest;
 extern test_func test_priority_donate_lower;
 extern test_func test_priority_donate_chain;
+extern test_func test_priority_donate_latency;
+extern test_func test_sched_trace;
+extern test_func test_workqueue;
+extern test_func test_softirq_nest;
+extern test_func test_rwlock_bench;
+extern test_func test_seqlock_bench;
+extern test_func test_completion_bench;
+extern test_func test_lockstat;
+extern test_func test_spawn_bench;
+extern test_func test_edf_admit;
+extern test_func test_edf_mixed;
+extern test_func test_intr_stat;
+extern test_func test_palloc_bench;
+extern test_func test_slab;
+extern test_func test_malloc_bench;
+extern test_func test_malloc_mag;
+extern test_func test_palloc_zero;
+extern test_func test_large_page;
+extern test_func test_palloc_elastic;
+extern test_func test_kmem_stat;
 extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
@@ -32,8 +56,11 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_tick_work;
+extern test_func test_mlfqs_edf;
 
 void msg (const char *, ...);
+void report (const char *, ...);
 void fail (const char *, ...);
 void pass (void);
 
@@ -0,0 +1,92 @@
+/* Queues work on each of the system workqueues and checks that
+   each priority class runs in priority order, in thread context.
+   Then hands work off from an interrupt: a high-resolution timer
+   raises a softirq, whose handler runs with interrupts on and
+   queues a work item that wakes up the main thread. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timer.h"
+
+/* Order in which work items ran, and their names. */
+static const char *order[WORK_CLASS_CNT];
+static int order_cnt;
+
+static struct semaphore done;
+static int softirq_nr;
+static bool softirq_ok;
+static struct work deferred;
+
+static void record (struct work *);
+static void timer_expired (struct hrtimer *);
+static void test_softirq (void);
+static void deferred_work (struct work *);
+
+void
+test_workqueue (void) 
+{
+  static const char *names[WORK_CLASS_CNT] = {"high", "normal", "low"};
+  struct work works[WORK_CLASS_CNT];
+  struct hrtimer timer;
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  sema_init (&done, 0);
+  for (i = WORK_CLASS_CNT - 1; i >= 0; i--) 
+    {
+      work_init (&works[i], record, (void *) names[i]);
+      work_schedule (i, &works[i]);
+    }
+  for (i = 0; i < WORK_CLASS_CNT; i++)
+    sema_down (&done);
+  for (i = 0; i < order_cnt; i++)
+    msg ("%s priority work ran.", order[i]);
+
+  softirq_nr = softirq_register (test_softirq, "test");
+  work_init (&deferred, deferred_work, NULL);
+  hrtimer_init (&timer, timer_expired, NULL);
+  hrtimer_start (&timer, timer_ns () + 1000000);
+  sema_down (&done);
+  if (!softirq_ok)
+    fail ("softirq ran outside interrupt context or with interrupts off");
+  msg ("Work deferred from interrupt ran.");
+}
+
+/* Records the work item's name. */
+static void
+record (struct work *w) 
+{
+  if (intr_context ())
+    fail ("work ran in interrupt context");
+  order[order_cnt++] = w->aux;
+  sema_up (&done);
+}
+
+/* Timer interrupt: defer the rest to a softirq. */
+static void
+timer_expired (struct hrtimer *t UNUSED) 
+{
+  softirq_raise (softirq_nr);
+}
+
+/* Softirq: check the context, then defer to a thread. */
+static void
+test_softirq (void) 
+{
+  softirq_ok = intr_context () && intr_get_level () == INTR_ON;
+  work_schedule (WORK_NORMAL, &deferred);
+}
+
+/* Thread context, at last: wake up the main thread. */
+static void
+deferred_work (struct work *w UNUSED) 
+{
+  sema_up (&done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) high priority work ran.
+(workqueue) normal priority work ran.
+(workqueue) low priority work ran.
+(workqueue) Work deferred from interrupt ran.
+(workqueue) end
+EOF
+pass;
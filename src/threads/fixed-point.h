@@ -0,0 +1,64 @@
+#ifndef THREADS_FIXED_POINT_H
+#define THREADS_FIXED_POINT_H
+
+#include <stdint.h>
+
+/* Signed 17.14 fixed-point arithmetic, used by the multi-level
+   feedback queue scheduler for load_avg and recent_cpu.
+
+   A fixed-point number is stored in an int whose 14 low-order
+   bits are the fraction, so values up to about +/-131,071 are
+   representable.  Products and quotients of two fixed-point
+   numbers are computed in 64 bits to avoid overflowing the
+   intermediate result. */
+typedef int fixed_point;
+
+#define FIX_FRAC_BITS 14                        /* Fractional bits. */
+#define FIX_ONE (1 << FIX_FRAC_BITS)            /* 1.0 in fixed point. */
+
+/* Converts integer N to fixed point. */
+static inline fixed_point fix_int (int n) {
+  return n * FIX_ONE;
+}
+
+/* Returns the fixed-point value of the fraction N / D. */
+static inline fixed_point fix_frac (int n, int d) {
+  return (int64_t) n * FIX_ONE / d;
+}
+
+/* Converts X to an integer, rounding toward zero. */
+static inline int fix_trunc (fixed_point x) {
+  return x / FIX_ONE;
+}
+
+/* Converts X to an integer, rounding to nearest. */
+static inline int fix_round (fixed_point x) {
+  return (x >= 0 ? x + FIX_ONE / 2 : x - FIX_ONE / 2) / FIX_ONE;
+}
+
+/* Returns X + N, for integer N. */
+static inline fixed_point fix_add_int (fixed_point x, int n) {
+  return x + n * FIX_ONE;
+}
+
+/* Returns X * Y. */
+static inline fixed_point fix_mul (fixed_point x, fixed_point y) {
+  return (int64_t) x * y / FIX_ONE;
+}
+
+/* Returns X * N, for integer N. */
+static inline fixed_point fix_mul_int (fixed_point x, int n) {
+  return x * n;
+}
+
+/* Returns X / Y. */
+static inline fixed_point fix_div (fixed_point x, fixed_point y) {
+  return (int64_t) x * FIX_ONE / y;
+}
+
+/* Returns X / N, for integer N. */
+static inline fixed_point fix_div_int (fixed_point x, int n) {
+  return x / n;
+}
+
+#endif /* threads/fixed-point.h */
@@ -0,0 +1,222 @@
+#include "threads/fpu.h"
+#include <debug.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Lazy floating-point context switching.
+
+   The kernel itself never uses the FPU (it is compiled with
+   -msoft-float), so only user code does, and most threads never
+   touch it.  Rather than saving and restoring every thread's FPU
+   registers on every context switch, we leave them in the FPU
+   until another thread needs it:
+
+     - fpu_owner is the thread whose state is in the FPU.
+
+     - On a switch to any other thread, we set CR0.TS, so that
+       its first FPU, MMX, or SSE instruction raises #NM.
+
+     - The #NM handler saves the owner's state into the owner's
+       save area, loads the running thread's, makes it the owner,
+       and clears CR0.TS so that the instruction can be restarted.
+
+   A thread's save area is allocated on its first FPU use.  With
+   FXSR, the save area holds the SSE registers too and SSE is
+   enabled; otherwise, it holds the x87 state only.  See
+   [IA32-v3a] 13.4 "Designing OS Facilities for Saving x87 FPU,
+   SSE, and Extended States on Task or Context Switches". */
+
+/* CR0 bits.  See [IA32-v3a] 2.5 "Control Registers". */
+#define CR0_MP 0x00000002       /* Monitor Coprocessor. */
+#define CR0_EM 0x00000004       /* (Floating-point) Emulation. */
+#define CR0_TS 0x00000008       /* Task Switched. */
+#define CR0_NE 0x00000020       /* Numeric Error. */
+
+/* CR4 bits. */
+#define CR4_OSFXSR 0x00000200   /* FXSAVE, FXRSTOR, and SSE enabled. */
+#define CR4_OSXMMEXCPT 0x00000400 /* #XF for unmasked SIMD errors. */
+
+/* Size and alignment of a save area. */
+#define FPU_AREA_SIZE 512       /* FXSAVE; FNSAVE needs only 108. */
+#define FPU_AREA_ALIGN 16
+
+/* Initial MXCSR: all SIMD exceptions masked. */
+#define MXCSR_DEFAULT 0x1f80
+
+static bool fxsr;               /* FXSAVE and FXRSTOR supported? */
+static bool sse;                /* SSE supported? */
+static struct thread *fpu_owner; /* Thread whose state is in the FPU. */
+
+/* Statistics. */
+static long long restore_cnt;   /* # of states loaded into the FPU. */
+static long long save_cnt;      /* # of states saved from the FPU. */
+
+static intr_handler_func fpu_trap;
+static void *save_area (struct thread *);
+static void set_ts (void);
+static void clear_ts (void);
+
+/* Enables the FPU, and SSE if the CPU supports it, and installs
+   the #NM handler that switches FPU state lazily. */
+void
+fpu_init (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t cr0, cr4;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  fxsr = (edx & (1u << 24)) != 0;
+  sse = fxsr && (edx & (1u << 25)) != 0;
+  if (fxsr) 
+    {
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      cr4 |= CR4_OSFXSR;
+      if (sse)
+        cr4 |= CR4_OSXMMEXCPT;
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4));
+    }
+
+  /* Stop emulating floating point, which start.S turned on, and
+     have no thread own the FPU. */
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  cr0 = (cr0 & ~CR0_EM) | CR0_MP | CR0_NE | CR0_TS;
+  asm volatile ("movl %0, %%cr0" : : "r" (cr0));
+
+  intr_register_int (7, 0, INTR_OFF, fpu_trap,
+                     "#NM Device Not Available Exception");
+}
+
+/* Called by the scheduler, with interrupts off, when thread T
+   starts running.  Lets T use the FPU directly if it owns it, and
+   otherwise makes its first use trap. */
+void
+fpu_switch (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t == fpu_owner)
+    clear_ts ();
+  else
+    set_ts ();
+}
+
+/* Called as thread T, the running thread, exits.  Frees T's save
+   area and abandons its FPU state. */
+void
+fpu_exit (struct thread *t) 
+{
+  enum intr_level old_level = intr_disable ();
+  void *area = t->fpu;
+
+  if (fpu_owner == t)
+    fpu_owner = NULL;
+  t->fpu = NULL;
+  intr_set_level (old_level);
+
+  free (area);
+}
+
+/* Prints FPU statistics. */
+void
+fpu_print_stats (void) 
+{
+  printf ("FPU: %lld state loads, %lld state saves\n", restore_cnt, save_cnt);
+}
+
+/* #NM handler: gives the FPU to the running thread, which just
+   tried to use it. */
+static void
+fpu_trap (struct intr_frame *f) 
+{
+  struct thread *cur = thread_current ();
+
+  if (f->cs == SEL_KCSEG) 
+    {
+      intr_dump_frame (f);
+      PANIC ("Kernel bug - floating point used in kernel");
+    }
+
+  /* Allocate a save area on first use.  This may sleep, so
+     interrupts must be on. */
+  if (cur->fpu == NULL) 
+    {
+      void *area;
+
+      intr_enable ();
+      area = malloc (FPU_AREA_SIZE + FPU_AREA_ALIGN - 1);
+      intr_disable ();
+      if (area == NULL) 
+        {
+          printf ("%s: no memory for FPU state\n", thread_name ());
+          intr_enable ();
+          thread_exit ();
+        }
+      cur->fpu = area;
+      cur->fpu_saved = false;
+    }
+
+  clear_ts ();
+  if (fpu_owner == cur)
+    return;
+
+  if (fpu_owner != NULL) 
+    {
+      if (fxsr)
+        asm volatile ("fxsave (%0)" : : "r" (save_area (fpu_owner)) : "memory");
+      else
+        asm volatile ("fnsave (%0)" : : "r" (save_area (fpu_owner)) : "memory");
+      fpu_owner->fpu_saved = true;
+      save_cnt++;
+    }
+
+  if (cur->fpu_saved) 
+    {
+      if (fxsr)
+        asm volatile ("fxrstor (%0)" : : "r" (save_area (cur)) : "memory");
+      else
+        asm volatile ("frstor (%0)" : : "r" (save_area (cur)) : "memory");
+      restore_cnt++;
+    }
+  else 
+    {
+      uint32_t mxcsr = MXCSR_DEFAULT;
+
+      asm volatile ("fninit");
+      if (sse)
+        asm volatile ("ldmxcsr %0" : : "m" (mxcsr));
+    }
+  fpu_owner = cur;
+}
+
+/* Returns the aligned save area of thread T, which must have
+   been allocated. */
+static void *
+save_area (struct thread *t) 
+{
+  ASSERT (t->fpu != NULL);
+  return (void *) ROUND_UP ((uintptr_t) t->fpu, FPU_AREA_ALIGN);
+}
+
+/* Makes the next FPU instruction raise #NM. */
+static void
+set_ts (void) 
+{
+  uint32_t cr0;
+
+  asm volatile ("movl %%cr0, %0" : "=r" (cr0));
+  if ((cr0 & CR0_TS) == 0)
+    asm volatile ("movl %0, %%cr0" : : "r" (cr0 | CR0_TS));
+}
+
+/* Lets FPU instructions execute without raising #NM. */
+static void
+clear_ts (void) 
+{
+  asm volatile ("clts");
+}
@@ -15,13 +15,19 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
+#include "threads/kmem.h"
+#include "threads/lockstat.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/pte.h"
+#include "threads/sched-trace.h"
 #include "threads/thread.h"
+#include "threads/workqueue.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -41,6 +47,19 @@
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
 
+/* Are 4 MB pages enabled?  Set by paging_init() if the CPU
+   supports them, unless the -nopse option is given. */
+bool large_pages;
+
+/* -nopse: Map memory with 4 kB pages only? */
+static bool no_pse;
+
+/* CR4 bit that enables 4 MB pages (Page Size Extensions). */
+#define CR4_PSE 0x00000010
+
+/* -intrstat: Collect interrupt timing statistics? */
+static bool intrstat;
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -54,11 +73,13 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
-/* -ul: Maximum number of pages to put into palloc's user pool. */
+/* -ul: Maximum number of pages allocated from palloc's user pool
+   at once.  The user pool itself grows and shrinks as needed. */
 static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init (void);
 static void paging_init (void);
+static bool cpu_has_pse (void);
 
 static char **read_command_line (void);
 static char **parse_options (char **argv);
@@ -96,7 +117,9 @@ main (void)
 
   /* Initialize memory system. */
   palloc_init (user_page_limit);
+  kmem_init ();
   malloc_init ();
+  slab_init ();
   paging_init ();
 
   /* Segmentation. */
@@ -107,6 +130,7 @@ main (void)
 
   /* Initialize interrupt handlers. */
   intr_init ();
+  fpu_init ();
   timer_init ();
   kbd_init ();
   input_init ();
@@ -117,11 +141,15 @@ main (void)
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
+  workqueue_init ();
   serial_init_queue ();
   timer_calibrate ();
+  if (intrstat && !intr_stats_start ())
+    printf ("No TSC, so no interrupt statistics.\n");
 
 #ifdef FILESYS
   /* Initialize file system. */
+  block_init ();
   ide_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
@@ -153,13 +181,23 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   If the CPU supports 4 MB pages, each 4 MB-aligned 4 MB of RAM
+   is mapped by a single PDE, which takes one TLB entry instead of
+   1,024.  The 4 MB that hold the kernel text, which is mapped
+   read-only, and any partial 4 MB at the end of RAM still use
+   4 kB pages. */
 static void
 paging_init (void)
 {
   uint32_t *pd, *pt;
   size_t page;
   extern char _start, _end_kernel_text;
+  uintptr_t text_start = vtop (&_start);
+  uintptr_t text_end = vtop (&_end_kernel_text);
+
+  large_pages = !no_pse && cpu_has_pse ();
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
@@ -171,6 +209,15 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (large_pages && paddr % PTSPAN == 0
+          && init_ram_pages - page >= PTSPAN / PGSIZE
+          && (paddr + PTSPAN <= text_start || paddr >= text_end))
+        {
+          pd[pde_idx] = pde_create_large (vaddr, true);
+          page += PTSPAN / PGSIZE - 1;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
@@ -180,6 +227,16 @@ paging_init (void)
       pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
     }
 
+  /* Turn on 4 MB pages before we use them.  See [IA32-v3a] 3.7.3
+     "Mixing 4-KByte and 4-MByte Pages". */
+  if (large_pages)
+    {
+      uint32_t cr4;
+
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+    }
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -188,6 +245,17 @@ paging_init (void)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (init_page_dir)));
 }
 
+/* Returns true if CPUID reports support for 4 MB pages.  See
+   [IA32-v2a] "CPUID". */
+static bool
+cpu_has_pse (void) 
+{
+  uint32_t eax, ebx, ecx, edx;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  return (edx & (1u << 3)) != 0;
+}
+
 /* Breaks the kernel command line into words and returns them as
    an argv-like array. */
 static char **
@@ -256,6 +324,18 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
+      else if (!strcmp (name, "-schedtrace"))
+        sched_trace_dump = true;
+      else if (!strcmp (name, "-lockstat"))
+        lockstat_enabled = true;
+      else if (!strcmp (name, "-intrstat"))
+        intrstat = true;
+      else if (!strcmp (name, "-kmemtrack"))
+        kmem_track = true;
+      else if (!strcmp (name, "-nopse"))
+        no_pse = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -379,8 +459,14 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Stop the timer tick while the CPU is idle.\n"
+          "  -schedtrace        Print the scheduler trace at shutdown.\n"
+          "  -lockstat          Print lock contention statistics at shutdown.\n"
+          "  -intrstat          Print interrupt timing statistics at shutdown.\n"
+          "  -kmemtrack         Track kernel memory allocations by call site.\n"
+          "  -nopse             Map memory with 4 kB pages only.\n"
 #ifdef USERPROG
-          "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -ul=COUNT          Allocate at most COUNT user pages at once.\n"
 #endif
           );
   shutdown_power_off ();
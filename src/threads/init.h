@@ -9,4 +9,7 @@
 /* Page directory with kernel mappings only. */
 extern uint32_t *init_page_dir;
 
+/* Are 4 MB pages enabled? */
+extern bool large_pages;
+
 #endif /* threads/init.h */
@@ -3,12 +3,14 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "devices/timer.h"
+#include "devices/tsc.h"
 
 /* Programmable Interrupt Controller (PIC) registers.
    A PC has two PICs, called the master and slave PICs, with the
@@ -47,6 +49,56 @@ static unsigned int unexpected_cnt[INTR_CNT];
 static bool in_external_intr;   /* Are we processing an external interrupt? */
 static bool yield_on_return;    /* Should we yield on interrupt return? */
 
+/* Deferred interrupt work ("softirqs").  An external interrupt
+   handler with more work than it should do with interrupts off
+   raises a softirq, whose handler runs with interrupts back on
+   just before the outermost external interrupt returns.
+
+   Softirq handlers still run in interrupt context, so they may
+   not sleep.  External interrupts may arrive while they run;
+   those are handled at once but their own softirqs, if any, wait
+   for the softirq loop in progress. */
+#define SOFTIRQ_CNT 32          /* Maximum number of softirqs. */
+#define SOFTIRQ_RESTART_MAX 10  /* Passes before deferring the rest. */
+static softirq_func *softirq_handlers[SOFTIRQ_CNT];
+static const char *softirq_names[SOFTIRQ_CNT];
+static int softirq_cnt;         /* Number of registered softirqs. */
+static uint32_t softirq_pending; /* Bit N set if softirq N raised. */
+static bool in_softirq;         /* Are we running softirq handlers? */
+
+/* Interrupt timing statistics, collected once
+   intr_stats_start() has been called.  Times are read from the
+   TSC directly, not through timer_ns(), because timer_ns()
+   itself disables interrupts.  All of this is protected by
+   disabling interrupts, with plain CLI so as not to count the
+   bookkeeping as an interrupts-off interval. */
+static bool stats_enabled;
+static struct intr_stat vec_stats[INTR_CNT]; /* Handler durations. */
+static struct intr_stat off_stat;       /* Interrupts-off intervals. */
+static struct intr_stat yield_stat;     /* Interrupt-to-yield latency. */
+static uint64_t off_start;      /* TSC when interrupts went off, or 0. */
+static const void *off_site;    /* Code that turned them off. */
+static uint64_t yield_start;    /* TSC at entry of yielding interrupt. */
+
+/* Interrupts-off intervals by the code that disabled interrupts,
+   identified by return address.  Once the table is full,
+   further sites share the last entry. */
+#define OFF_SITE_CNT 32
+struct off_site 
+  {
+    const void *site;           /* Return address of intr_disable(). */
+    uint64_t count;             /* Number of intervals. */
+    uint64_t total_ns;          /* Sum of their durations. */
+    uint64_t max_ns;            /* Longest single interval. */
+  };
+static struct off_site off_sites[OFF_SITE_CNT];
+static int off_site_cnt;
+
+static void stats_disable (const void *site);
+static void stats_enable (void);
+static void stat_record (struct intr_stat *, uint64_t start, uint64_t end);
+static void stat_print (const char *name, const struct intr_stat *);
+
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
@@ -58,6 +110,7 @@ static inline uint64_t make_idtr_operand (uint16_t limit, void *base);
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
+static void softirq_run (void);
 static void unexpected_interrupt (const struct intr_frame *);
 
 /* Returns the current interrupt status. */
@@ -80,15 +133,31 @@ intr_get_level (void)
 enum intr_level
 intr_set_level (enum intr_level level) 
 {
-  return level == INTR_ON ? intr_enable () : intr_disable ();
+  enum intr_level old_level;
+
+  if (level == INTR_ON)
+    return intr_enable ();
+
+  /* Charge the interval to our caller, not to us. */
+  old_level = intr_get_level ();
+  asm volatile ("cli" : : : "memory");
+  if (old_level == INTR_ON)
+    stats_disable (__builtin_return_address (0));
+  return old_level;
 }
 
-/* Enables interrupts and returns the previous interrupt status. */
+/* Enables interrupts and returns the previous interrupt status.
+   May not be called by an external interrupt handler, which must
+   run with interrupts off.  Softirq handlers run with interrupts
+   on, so they may turn them back on after turning them off. */
 enum intr_level
 intr_enable (void) 
 {
   enum intr_level old_level = intr_get_level ();
-  ASSERT (!intr_context ());
+  ASSERT (!in_external_intr);
+
+  if (old_level == INTR_OFF)
+    stats_enable ();
 
   /* Enable interrupts by setting the interrupt flag.
 
@@ -110,6 +179,8 @@ intr_disable (void)
      Hardware Interrupts". */
   asm volatile ("cli" : : : "memory");
 
+  if (old_level == INTR_ON)
+    stats_disable (__builtin_return_address (0));
   return old_level;
 }
 
@@ -206,12 +277,45 @@ intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
   register_handler (vec_no, dpl, level, handler, name);
 }
 
-/* Returns true during processing of an external interrupt
-   and false at all other times. */
+/* Returns true during processing of an external interrupt or
+   of a softirq and false at all other times.  Code that may
+   sleep asserts that this returns false, since neither an
+   external interrupt handler nor a softirq handler may sleep. */
 bool
 intr_context (void) 
 {
-  return in_external_intr;
+  return in_external_intr || in_softirq;
+}
+
+/* Registers HANDLER as a new softirq named NAME, for debugging
+   purposes, and returns its number, to pass to softirq_raise(). */
+int
+softirq_register (softirq_func *handler, const char *name) 
+{
+  enum intr_level old_level = intr_disable ();
+  int nr = softirq_cnt++;
+
+  ASSERT (nr < SOFTIRQ_CNT);
+  softirq_handlers[nr] = handler;
+  softirq_names[nr] = name;
+  intr_set_level (old_level);
+  return nr;
+}
+
+/* Marks softirq NR pending, so that its handler runs when the
+   current external interrupt returns or, if called outside an
+   external interrupt, when the next one returns.  Raising a
+   softirq that is already pending has no further effect. */
+void
+softirq_raise (int nr) 
+{
+  enum intr_level old_level;
+
+  ASSERT (nr >= 0 && nr < softirq_cnt);
+
+  old_level = intr_disable ();
+  softirq_pending |= 1u << nr;
+  intr_set_level (old_level);
 }
 
 /* During processing of an external interrupt, directs the
@@ -346,6 +450,17 @@ intr_handler (struct intr_frame *frame)
 {
   bool external;
   intr_handler_func *handler;
+  uint64_t start = 0;
+
+  /* If the interrupted code had interrupts on, then any
+     interrupts-off interval still open was ended by an IRET or
+     STI without going through intr_enable(). */
+  if (stats_enabled) 
+    {
+      start = tsc_read ();
+      if (frame->eflags & FLAG_IF)
+        off_start = 0;
+    }
 
   /* External interrupts are special.
      We only handle one at a time (so interrupts must be off)
@@ -355,10 +470,14 @@ intr_handler (struct intr_frame *frame)
   if (external) 
     {
       ASSERT (intr_get_level () == INTR_OFF);
-      ASSERT (!intr_context ());
+      ASSERT (!in_external_intr);
 
       in_external_intr = true;
-      yield_on_return = false;
+      if (!in_softirq)
+        yield_on_return = false;
+
+      /* Catch up on ticks skipped while the CPU was idle. */
+      timer_irq_enter ();
     }
 
   /* Invoke the interrupt's handler. */
@@ -373,6 +492,8 @@ intr_handler (struct intr_frame *frame)
     }
   else
     unexpected_interrupt (frame);
+  if (start != 0)
+    stat_record (&vec_stats[frame->vec_no], start, tsc_read ());
 
   /* Complete the processing of an external interrupt. */
   if (external) 
@@ -383,9 +504,54 @@ intr_handler (struct intr_frame *frame)
       in_external_intr = false;
       pic_end_of_interrupt (frame->vec_no); 
 
-      if (yield_on_return) 
-        thread_yield (); 
+      /* An interrupt that arrived during softirq processing
+         leaves its softirqs, and any yield, to the outer
+         interrupt. */
+      if (!in_softirq) 
+        {
+          softirq_run ();
+          if (yield_on_return) 
+            {
+              yield_start = start;
+              thread_yield (); 
+            }
+        }
+    }
+
+  /* Our IRET will turn interrupts back on. */
+  if (frame->eflags & FLAG_IF)
+    off_start = 0;
+}
+
+/* Runs the handlers of pending softirqs, with interrupts on,
+   until none is pending or SOFTIRQ_RESTART_MAX passes have run,
+   in which case the rest waits for the next external interrupt
+   so that a stream of softirqs cannot starve threads. */
+static void
+softirq_run (void) 
+{
+  int pass;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (!in_softirq);
+
+  in_softirq = true;
+  for (pass = 0; softirq_pending != 0 && pass < SOFTIRQ_RESTART_MAX; pass++)
+    {
+      uint32_t pending = softirq_pending;
+      int nr;
+
+      softirq_pending = 0;
+      intr_enable ();
+      for (nr = 0; pending != 0; nr++)
+        if (pending & (1u << nr)) 
+          {
+            pending &= ~(1u << nr);
+            softirq_handlers[nr] ();
+          }
+      intr_disable ();
     }
+  in_softirq = false;
 }
 
 /* Handles an unexpected interrupt with interrupt frame F.  An
@@ -436,3 +602,190 @@ intr_name (uint8_t vec)
 {
   return intr_names[vec];
 }
+
+/* Interrupt statistics. */
+
+/* Starts collecting interrupt statistics, if the TSC has been
+   calibrated.  Returns true if successful. */
+bool
+intr_stats_start (void) 
+{
+  if (tsc_frequency () == 0)
+    return false;
+  stats_enabled = true;
+  return true;
+}
+
+/* Called by thread_schedule_tail() when a thread has been
+   scheduled.  If the switch was caused by an external
+   interrupt's intr_yield_on_return(), records the latency from
+   the interrupt's arrival. */
+void
+intr_stats_switch (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (yield_start != 0) 
+    {
+      stat_record (&yield_stat, yield_start, tsc_read ());
+      yield_start = 0;
+    }
+}
+
+/* Copies the statistic selected by WHICH, an interrupt vector
+   number or INTR_STAT_OFF or INTR_STAT_YIELD, into *STAT.
+   Returns false if WHICH selects nothing. */
+bool
+intr_stats_get (int which, struct intr_stat *stat) 
+{
+  const struct intr_stat *s;
+  uint32_t flags;
+
+  if (which >= 0 && which < INTR_CNT)
+    s = &vec_stats[which];
+  else if (which == INTR_STAT_OFF)
+    s = &off_stat;
+  else if (which == INTR_STAT_YIELD)
+    s = &yield_stat;
+  else
+    return false;
+
+  asm volatile ("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+  *stat = *s;
+  asm volatile ("pushl %0; popfl" : : "g" (flags) : "memory", "cc");
+  return true;
+}
+
+/* Prints interrupt statistics, if they were collected. */
+void
+intr_print_stats (void) 
+{
+  struct intr_stat stat;
+  struct off_site sites[OFF_SITE_CNT];
+  enum intr_level old_level;
+  int cnt, i, j;
+  char name[32];
+
+  if (!stats_enabled)
+    return;
+
+  printf ("Intrstat: %-24s %10s %10s %10s\n",
+          "interval", "count", "avg ns", "max ns");
+  for (i = 0; i < INTR_CNT; i++)
+    if (intr_stats_get (i, &stat) && stat.count > 0) 
+      {
+        snprintf (name, sizeof name, "%#04x %s", i, intr_names[i]);
+        stat_print (name, &stat);
+      }
+  intr_stats_get (INTR_STAT_OFF, &stat);
+  stat_print ("interrupts off", &stat);
+  intr_stats_get (INTR_STAT_YIELD, &stat);
+  stat_print ("interrupt to yield", &stat);
+
+  /* Copy the site table, because printing turns interrupts off
+     and so changes it. */
+  old_level = intr_disable ();
+  cnt = off_site_cnt;
+  memcpy (sites, off_sites, sizeof *sites * cnt);
+  intr_set_level (old_level);
+
+  /* Insertion sort by decreasing maximum. */
+  for (i = 1; i < cnt; i++) 
+    {
+      struct off_site s = sites[i];
+      for (j = i; j > 0 && sites[j - 1].max_ns < s.max_ns; j--)
+        sites[j] = sites[j - 1];
+      sites[j] = s;
+    }
+  printf ("Intrstat: %-24s %10s %10s %10s\n",
+          "interrupts off by", "count", "avg ns", "max ns");
+  for (i = 0; i < cnt; i++) 
+    {
+      snprintf (name, sizeof name, "%p", sites[i].site);
+      printf ("Intrstat: %-24s %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+              name, sites[i].count, sites[i].total_ns / sites[i].count,
+              sites[i].max_ns);
+    }
+}
+
+/* Notes that interrupts have just been turned off by the code
+   that returns to SITE. */
+static void
+stats_disable (const void *site) 
+{
+  if (stats_enabled) 
+    {
+      off_start = tsc_read ();
+      off_site = site;
+    }
+}
+
+/* Ends the interrupts-off interval in progress, if any, just
+   before interrupts are turned back on. */
+static void
+stats_enable (void) 
+{
+  struct off_site *s;
+  uint64_t end, ns;
+  int i;
+
+  if (off_start == 0)
+    return;
+  end = tsc_read ();
+  stat_record (&off_stat, off_start, end);
+  ns = tsc_to_ns (end - off_start);
+  off_start = 0;
+
+  for (i = 0; i < off_site_cnt; i++)
+    if (off_sites[i].site == off_site)
+      break;
+  if (i < off_site_cnt)
+    s = &off_sites[i];
+  else if (off_site_cnt < OFF_SITE_CNT) 
+    {
+      s = &off_sites[off_site_cnt++];
+      s->site = off_site;
+    }
+  else
+    s = &off_sites[OFF_SITE_CNT - 1];
+  s->count++;
+  s->total_ns += ns;
+  if (ns > s->max_ns)
+    s->max_ns = ns;
+}
+
+/* Adds the interval from TSC value START to END to S. */
+static void
+stat_record (struct intr_stat *s, uint64_t start, uint64_t end) 
+{
+  uint64_t ns = tsc_to_ns (end - start);
+  uint32_t clamped = ns > UINT32_MAX ? UINT32_MAX : ns;
+  int bucket = clamped == 0 ? 0 : 31 - __builtin_clz (clamped);
+  uint32_t flags;
+
+  asm volatile ("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+  s->count++;
+  s->total_ns += ns;
+  if (ns > s->max_ns)
+    s->max_ns = ns;
+  s->hist[bucket]++;
+  asm volatile ("pushl %0; popfl" : : "g" (flags) : "memory", "cc");
+}
+
+/* Prints statistic S under NAME: its count, mean and maximum,
+   then the nonzero histogram buckets as "<LIMIT:COUNT". */
+static void
+stat_print (const char *name, const struct intr_stat *s) 
+{
+  int i;
+
+  if (s->count == 0)
+    return;
+  printf ("Intrstat: %-24s %10"PRIu64" %10"PRIu64" %10"PRIu64"\n",
+          name, s->count, s->total_ns / s->count, s->max_ns);
+  printf ("Intrstat:  ");
+  for (i = 0; i < INTR_STAT_BUCKETS; i++)
+    if (s->hist[i] != 0)
+      printf (" <%"PRIu64":%"PRIu32, (uint64_t) 2 << i, s->hist[i]);
+  printf ("\n");
+}
@@ -1,6 +1,7 @@
 #ifndef THREADS_INTERRUPT_H
 #define THREADS_INTERRUPT_H
 
+#include <intr-stat.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -64,6 +65,17 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
 bool intr_context (void);
 void intr_yield_on_return (void);
 
+/* Deferred interrupt work. */
+typedef void softirq_func (void);
+int softirq_register (softirq_func *, const char *name);
+void softirq_raise (int nr);
+
+/* Interrupt timing statistics. */
+bool intr_stats_start (void);
+void intr_stats_switch (void);
+bool intr_stats_get (int which, struct intr_stat *);
+void intr_print_stats (void);
+
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
 
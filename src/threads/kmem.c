@@ -0,0 +1,267 @@
+#include "threads/kmem.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <kmem-stat.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Kernel memory accounting.
+
+   kmem_get_stats() gathers the page allocator's per-pool counts
+   and malloc()'s per-size counts into one struct kmem_stats,
+   which the kmem_stats() system call copies out as is and
+   kmem_print_stats() prints at shutdown.
+
+   With "-kmemtrack", palloc_get_page(), palloc_get_multiple(),
+   malloc(), calloc(), and realloc() also report each allocation
+   with the address of their caller, and the matching frees
+   report each block going away.  The pages that malloc() takes
+   for arenas and big blocks are thus also charged to malloc()
+   itself.  Live allocations sit in an open addressing hash
+   table, so that a free can find the site and size to charge it
+   to.  Neither table can use malloc(), because
+   malloc() reports to them, so both have a fixed size: once the
+   live table is 3/4 full, further allocations are only counted,
+   and once the site table is full, further sites share its last
+   entry.  Both are protected by disabling interrupts. */
+
+/* Live allocation table size. */
+#define LIVE_BITS 12
+#define LIVE_CNT (1 << LIVE_BITS)
+#define LIVE_MAX (LIVE_CNT / 4 * 3)
+
+/* Site table size. */
+#define SITE_MAX 128
+
+/* Sites printed at shutdown. */
+#define SITE_PRINT 10
+
+/* A live allocation. */
+struct live
+  {
+    void *p;                    /* Block, or null if slot unused. */
+    size_t size;                /* Size requested. */
+    struct site *site;          /* Where it was allocated. */
+  };
+
+/* Allocations made from one place in the code. */
+struct site
+  {
+    const void *site;           /* Caller's return address. */
+    uint64_t allocs;            /* Number of allocations. */
+    size_t live_cnt;            /* Allocations not yet freed. */
+    size_t live_bytes;          /* Bytes in them. */
+  };
+
+/* See kmem.h. */
+bool kmem_track;
+
+/* Live allocations, or null if not tracking. */
+static struct live *live;
+static size_t live_cnt;
+static uint64_t untracked;      /* Allocations that did not fit. */
+
+/* Allocation sites. */
+static struct site sites[SITE_MAX];
+static int site_cnt;
+
+static struct site *find_site (const void *);
+static size_t live_hash (const void *);
+static void print_pool (const char *, const struct kmem_pool_stat *);
+
+/* Allocates the live allocation table, if tracking.  Must be
+   called after palloc_init(). */
+void
+kmem_init (void) 
+{
+  size_t page_cnt = DIV_ROUND_UP (sizeof *live * LIVE_CNT, PGSIZE);
+
+  if (kmem_track)
+    live = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, page_cnt);
+}
+
+/* Records that P, of SIZE bytes, was just allocated by a call
+   from SITE. */
+void
+kmem_track_alloc (void *p, size_t size, const void *site) 
+{
+  enum intr_level old_level;
+  struct site *s;
+  size_t i;
+
+  if (live == NULL)
+    return;
+
+  old_level = intr_disable ();
+  s = find_site (site);
+  s->allocs++;
+  if (live_cnt < LIVE_MAX) 
+    {
+      for (i = live_hash (p); live[i].p != NULL; i = (i + 1) % LIVE_CNT)
+        continue;
+      live[i].p = p;
+      live[i].size = size;
+      live[i].site = s;
+      live_cnt++;
+      s->live_cnt++;
+      s->live_bytes += size;
+    }
+  else
+    untracked++;
+  intr_set_level (old_level);
+}
+
+/* Records that P is about to be freed.  Does nothing if P was
+   not tracked. */
+void
+kmem_track_free (void *p) 
+{
+  enum intr_level old_level;
+  size_t i, j;
+
+  if (live == NULL)
+    return;
+
+  old_level = intr_disable ();
+  for (i = live_hash (p); live[i].p != NULL; i = (i + 1) % LIVE_CNT)
+    if (live[i].p == p)
+      break;
+  if (live[i].p != NULL) 
+    {
+      live[i].site->live_cnt--;
+      live[i].site->live_bytes -= live[i].size;
+      live_cnt--;
+
+      /* Shift back later entries of the same probe sequence, so
+         that lookups never stop short at the emptied slot. */
+      for (j = (i + 1) % LIVE_CNT; live[j].p != NULL;
+           j = (j + 1) % LIVE_CNT) 
+        {
+          size_t home = live_hash (live[j].p);
+          if ((j - home) % LIVE_CNT >= (j - i) % LIVE_CNT) 
+            {
+              live[i] = live[j];
+              i = j;
+            }
+        }
+      live[i].p = NULL;
+    }
+  intr_set_level (old_level);
+}
+
+/* Stores the current kernel memory usage into S. */
+void
+kmem_get_stats (struct kmem_stats *s) 
+{
+  memset (s, 0, sizeof *s);
+  palloc_get_stats (s);
+  malloc_get_stats (s);
+}
+
+/* Prints kernel memory usage and, if tracking, the sites that
+   hold the most memory. */
+void
+kmem_print_stats (void) 
+{
+  static struct site snapshot[SITE_MAX];
+  struct kmem_stats s;
+  enum intr_level old_level;
+  int cnt, i, j;
+
+  kmem_get_stats (&s);
+  print_pool ("kernel", &s.kernel);
+  print_pool ("user", &s.user);
+  printf ("Kmem: reservoir: %"PRIu32" pages\n", s.reservoir);
+  for (i = 0; i < (int) s.class_cnt; i++) 
+    {
+      struct kmem_class_stat *c = &s.classes[i];
+      uint32_t blocks = c->arenas * c->blocks_per_arena;
+
+      printf ("Kmem: %4"PRIu32"-byte blocks: %"PRIu32" per arena, "
+              "%"PRIu32" arenas (peak %"PRIu32"), %"PRIu32" in use, "
+              "%"PRIu32"%% unused\n",
+              c->block_size, c->blocks_per_arena, c->arenas,
+              c->peak_arenas, c->in_use,
+              blocks ? (blocks - c->in_use) * 100 / blocks : 0);
+    }
+  printf ("Kmem: big blocks: %"PRIu32" using %"PRIu32" pages "
+          "(peak %"PRIu32")\n", s.big_blocks, s.big_pages, s.peak_big_pages);
+
+  if (live == NULL)
+    return;
+
+  /* Copy the table, because printing itself allocates. */
+  old_level = intr_disable ();
+  cnt = site_cnt;
+  memcpy (snapshot, sites, sizeof *snapshot * cnt);
+  intr_set_level (old_level);
+
+  /* Insertion sort by decreasing live bytes. */
+  for (i = 1; i < cnt; i++) 
+    {
+      struct site c = snapshot[i];
+      for (j = i; j > 0 && snapshot[j - 1].live_bytes < c.live_bytes; j--)
+        snapshot[j] = snapshot[j - 1];
+      snapshot[j] = c;
+    }
+
+  printf ("Kmem: %-12s %10s %8s %10s\n",
+          "site", "allocs", "live", "live bytes");
+  for (i = 0; i < cnt && i < SITE_PRINT; i++) 
+    {
+      struct site *c = &snapshot[i];
+      char name[13];
+
+      if (c->site != NULL)
+        snprintf (name, sizeof name, "%p", c->site);
+      else
+        snprintf (name, sizeof name, "(others)");
+      printf ("Kmem: %-12s %10"PRIu64" %8zu %10zu\n",
+              name, c->allocs, c->live_cnt, c->live_bytes);
+    }
+  if (untracked > 0)
+    printf ("Kmem: %"PRIu64" allocations not tracked\n", untracked);
+}
+
+/* Returns the entry for allocations from SITE.  Interrupts must
+   be off. */
+static struct site *
+find_site (const void *site) 
+{
+  int i;
+
+  for (i = 0; i < site_cnt; i++)
+    if (sites[i].site == site)
+      return &sites[i];
+  if (site_cnt < SITE_MAX) 
+    {
+      sites[site_cnt].site = site;
+      return &sites[site_cnt++];
+    }
+  sites[SITE_MAX - 1].site = NULL;
+  return &sites[SITE_MAX - 1];
+}
+
+/* Returns the home slot for P in the live table. */
+static size_t
+live_hash (const void *p) 
+{
+  return (uint32_t) ((uintptr_t) p * 0x9e3779b1u) >> (32 - LIVE_BITS);
+}
+
+/* Prints the usage of the pool named NAME described by S. */
+static void
+print_pool (const char *name, const struct kmem_pool_stat *s) 
+{
+  printf ("Kmem: %s pool: %"PRIu32" pages, %"PRIu32" free, "
+          "%"PRIu32" used (peak %"PRIu32"), largest free block "
+          "%"PRIu32" pages, %"PRIu32"%% fragmented\n",
+          name, s->pages, s->free, s->used, s->peak_used, s->largest_free,
+          s->free ? (s->free - s->largest_free) * 100 / s->free : 0);
+}
@@ -0,0 +1,19 @@
+#ifndef THREADS_KMEM_H
+#define THREADS_KMEM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct kmem_stats;
+
+/* Track allocations by call site?
+   Controlled by kernel command-line option "-kmemtrack". */
+extern bool kmem_track;
+
+void kmem_init (void);
+void kmem_track_alloc (void *, size_t size, const void *site);
+void kmem_track_free (void *);
+void kmem_get_stats (struct kmem_stats *);
+void kmem_print_stats (void);
+
+#endif /* threads/kmem.h */
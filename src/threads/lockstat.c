@@ -0,0 +1,150 @@
+#include "threads/lockstat.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+
+/* Lock classes.  lock_init() and sema_init() look up their
+   class here, which cannot use malloc() because malloc() itself
+   uses locks, so the table has a fixed size.  Once it is full,
+   further classes share the last entry.  Protected by disabling
+   interrupts. */
+#define CLASS_MAX 64
+static struct lock_class classes[CLASS_MAX];
+static int class_cnt;
+
+/* See lockstat.h. */
+bool lockstat_enabled;
+
+static bool class_matches (const struct lock_class *,
+                           const char *name, const void *site);
+
+/* Returns the class for locks (if IS_LOCK) or semaphores named
+   NAME, or if NAME is null, for those initialized at SITE. */
+struct lock_class *
+lockstat_class (const char *name, const void *site, bool is_lock) 
+{
+  enum intr_level old_level = intr_disable ();
+  struct lock_class *c;
+  int i;
+
+  for (i = 0; i < class_cnt; i++)
+    if (class_matches (&classes[i], name, site)
+        && classes[i].is_lock == is_lock)
+      break;
+  if (i < class_cnt)
+    c = &classes[i];
+  else if (class_cnt < CLASS_MAX) 
+    {
+      c = &classes[class_cnt++];
+      c->name = name;
+      c->site = name == NULL ? site : NULL;
+      c->is_lock = is_lock;
+    }
+  else 
+    {
+      c = &classes[CLASS_MAX - 1];
+      c->name = "(others)";
+    }
+  intr_set_level (old_level);
+  return c;
+}
+
+/* Records an acquisition of a lock or semaphore in class C,
+   which waited WAIT_NS nanoseconds if CONTENDED. */
+void
+lockstat_acquired (struct lock_class *c, bool contended, int64_t wait_ns) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  c->acquired++;
+  if (contended) 
+    {
+      c->contended++;
+      c->wait_ns += wait_ns;
+      if (wait_ns > c->max_wait_ns)
+        c->max_wait_ns = wait_ns;
+    }
+  intr_set_level (old_level);
+}
+
+/* Records that a lock in class C was released after being held
+   for HOLD_NS nanoseconds. */
+void
+lockstat_released (struct lock_class *c, int64_t hold_ns) 
+{
+  enum intr_level old_level = intr_disable ();
+  c->hold_ns += hold_ns;
+  intr_set_level (old_level);
+}
+
+/* Prints the statistics for every class that has been used,
+   most total wait time first, so that the hottest locks head the
+   list. */
+void
+lockstat_print (void) 
+{
+  struct lock_class *snapshot;
+  enum intr_level old_level;
+  int cnt, i, j;
+
+  if (!lockstat_enabled)
+    return;
+
+  /* Copy the table, because printing itself takes the console
+     lock. */
+  snapshot = malloc (sizeof *snapshot * CLASS_MAX);
+  if (snapshot == NULL)
+    return;
+  old_level = intr_disable ();
+  cnt = class_cnt;
+  memcpy (snapshot, classes, sizeof *snapshot * cnt);
+  intr_set_level (old_level);
+
+  /* Insertion sort by decreasing wait time. */
+  for (i = 1; i < cnt; i++) 
+    {
+      struct lock_class c = snapshot[i];
+      for (j = i; j > 0 && snapshot[j - 1].wait_ns < c.wait_ns; j--)
+        snapshot[j] = snapshot[j - 1];
+      snapshot[j] = c;
+    }
+
+  printf ("Lockstat: %-24s %10s %9s %10s %10s %10s\n", "class",
+          "acquired", "contended", "wait us", "max us", "hold us");
+  for (i = 0; i < cnt; i++) 
+    {
+      struct lock_class *c = &snapshot[i];
+      char name[25];
+
+      if (c->acquired == 0)
+        continue;
+      if (c->name != NULL)
+        snprintf (name, sizeof name, "%s", c->name);
+      else
+        snprintf (name, sizeof name, "%s@%p",
+                  c->is_lock ? "lock" : "sema", c->site);
+      printf ("Lockstat: %-24s %10"PRIu64" %9"PRIu64" %10"PRId64
+              " %10"PRId64" ", name, c->acquired, c->contended,
+              c->wait_ns / 1000, c->max_wait_ns / 1000);
+      if (c->is_lock)
+        printf ("%10"PRId64"\n", c->hold_ns / 1000);
+      else
+        printf ("%10s\n", "-");
+    }
+  free (snapshot);
+}
+
+/* Returns true if class C is the one for NAME or, if NAME is
+   null, for SITE. */
+static bool
+class_matches (const struct lock_class *c, const char *name,
+               const void *site) 
+{
+  if (name != NULL)
+    return c->name != NULL && !strcmp (c->name, name);
+  else
+    return c->name == NULL && c->site == site;
+}
@@ -0,0 +1,33 @@
+#ifndef THREADS_LOCKSTAT_H
+#define THREADS_LOCKSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Contention statistics for a class of locks or semaphores: all
+   of those initialized with the same name or, if unnamed, at the
+   same place in the code. */
+struct lock_class 
+  {
+    const char *name;           /* Name, or null if unnamed. */
+    const void *site;           /* Return address of the init call. */
+    bool is_lock;               /* Locks, as opposed to semaphores? */
+    uint64_t acquired;          /* Number of acquisitions. */
+    uint64_t contended;         /* Acquisitions that had to wait. */
+    int64_t wait_ns;            /* Total time spent waiting. */
+    int64_t max_wait_ns;        /* Longest single wait. */
+    int64_t hold_ns;            /* Total time held, for locks. */
+  };
+
+/* Collect lock statistics?
+   Controlled by kernel command-line option "-lockstat". */
+extern bool lockstat_enabled;
+
+struct lock_class *lockstat_class (const char *name, const void *site,
+                                   bool is_lock);
+void lockstat_acquired (struct lock_class *, bool contended,
+                        int64_t wait_ns);
+void lockstat_released (struct lock_class *, int64_t hold_ns);
+void lockstat_print (void);
+
+#endif /* threads/lockstat.h */
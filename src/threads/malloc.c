@@ -1,12 +1,16 @@
 #include "threads/malloc.h"
 #include <debug.h>
+#include <kmem-stat.h>
 #include <list.h>
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
+#include "threads/kmem.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
@@ -32,7 +36,22 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   In front of the descriptors sit per-thread "magazines": each
+   thread keeps, for each block size, a stack of up to MAG_MAX
+   free blocks, linked through the blocks themselves.  Only the
+   owning thread touches its magazines, so most malloc() and
+   free() calls take no lock.  An empty magazine is refilled with
+   MAG_BATCH blocks, and an overfull one drained of MAG_BATCH
+   blocks, under one acquisition of the descriptor's lock.  Blocks
+   in magazines still count as in use in their arenas, so an
+   arena cannot be freed while a magazine holds one of its
+   blocks; a thread's magazines are drained when it exits. */
+
+/* Magazine sizes. */
+#define MAG_BATCH 8             /* Blocks moved per refill or drain. */
+#define MAG_MAX 16              /* Most blocks in one magazine. */
 
 /* Descriptor. */
 struct desc
@@ -41,6 +60,11 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Statistics, protected by LOCK. */
+    size_t arena_cnt;           /* Arenas allocated now. */
+    size_t peak_arenas;         /* Most arenas ever allocated. */
+    size_t in_use;              /* Blocks not on FREE_LIST. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -60,12 +84,32 @@ struct block
     struct list_elem free_elem; /* Free list element. */
   };
 
+/* Free block in a magazine. */
+struct mag_block 
+  {
+    struct mag_block *next;     /* Next block in magazine. */
+  };
+
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[MALLOC_CLASS_CNT]; /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Big blocks allocated now, pages in them, and the most pages
+   ever in them.  Protected by disabling interrupts. */
+static size_t big_cnt;
+static size_t big_pages;
+static size_t peak_big_pages;
+
+/* See malloc.h. */
+bool malloc_magazines = true;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct block *desc_get (struct desc *);
+static void desc_put (struct desc *, struct block *);
+static void mag_refill (struct desc *, struct malloc_mag *);
+static void mag_drain (struct desc *, struct malloc_mag *, size_t cnt);
+static void *do_malloc (size_t, const void *site);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -80,18 +124,70 @@ malloc_init (void)
       d->block_size = block_size;
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
-      lock_init (&d->lock);
+      lock_init_named (&d->lock, "malloc");
+      d->arena_cnt = d->peak_arenas = d->in_use = 0;
+    }
+  ASSERT (desc_cnt == MALLOC_CLASS_CNT);
+}
+
+/* Returns the blocks in the running thread's magazines to their
+   descriptors.  Called by thread_exit(). */
+void
+malloc_thread_exit (void) 
+{
+  struct thread *t = thread_current ();
+  size_t i;
+
+  for (i = 0; i < desc_cnt; i++)
+    mag_drain (&descs[i], &t->mags[i], t->mags[i].cnt);
+}
+
+/* Stores the usage of each block size and of big blocks into
+   S. */
+void
+malloc_get_stats (struct kmem_stats *s) 
+{
+  enum intr_level old_level;
+  size_t i;
+
+  s->class_cnt = desc_cnt < KMEM_CLASS_MAX ? desc_cnt : KMEM_CLASS_MAX;
+  for (i = 0; i < s->class_cnt; i++) 
+    {
+      struct desc *d = &descs[i];
+      struct kmem_class_stat *c = &s->classes[i];
+
+      lock_acquire (&d->lock);
+      c->block_size = d->block_size;
+      c->blocks_per_arena = d->blocks_per_arena;
+      c->arenas = d->arena_cnt;
+      c->peak_arenas = d->peak_arenas;
+      c->in_use = d->in_use;
+      lock_release (&d->lock);
     }
+
+  old_level = intr_disable ();
+  s->big_blocks = big_cnt;
+  s->big_pages = big_pages;
+  s->peak_big_pages = peak_big_pages;
+  intr_set_level (old_level);
 }
 
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
 malloc (size_t size) 
+{
+  return do_malloc (size, __builtin_return_address (0));
+}
+
+/* Does the work of malloc(), which was called from SITE. */
+static void *
+do_malloc (size_t size, const void *site) 
 {
   struct desc *d;
   struct block *b;
   struct arena *a;
+  void *p;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -107,6 +203,8 @@ malloc (size_t size)
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
+      enum intr_level old_level;
+
       a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
         return NULL;
@@ -116,41 +214,44 @@ malloc (size_t size)
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
-      return a + 1;
-    }
 
-  lock_acquire (&d->lock);
+      old_level = intr_disable ();
+      big_cnt++;
+      big_pages += page_cnt;
+      if (big_pages > peak_big_pages)
+        peak_big_pages = big_pages;
+      intr_set_level (old_level);
 
-  /* If the free list is empty, create a new arena. */
-  if (list_empty (&d->free_list))
+      p = a + 1;
+    }
+  else if (malloc_magazines) 
     {
-      size_t i;
-
-      /* Allocate a page. */
-      a = palloc_get_page (0);
-      if (a == NULL) 
-        {
-          lock_release (&d->lock);
-          return NULL; 
-        }
+      struct malloc_mag *m = &thread_current ()->mags[d - descs];
+      struct mag_block *mb;
 
-      /* Initialize arena and add its blocks to the free list. */
-      a->magic = ARENA_MAGIC;
-      a->desc = d;
-      a->free_cnt = d->blocks_per_arena;
-      for (i = 0; i < d->blocks_per_arena; i++) 
-        {
-          struct block *b = arena_to_block (a, i);
-          list_push_back (&d->free_list, &b->free_elem);
-        }
+      ASSERT (!intr_context ());
+      if (m->cnt == 0)
+        mag_refill (d, m);
+      if (m->cnt == 0)
+        return NULL;
+      mb = m->top;
+      m->top = mb->next;
+      m->cnt--;
+      p = mb;
+    }
+  else 
+    {
+      lock_acquire (&d->lock);
+      b = desc_get (d);
+      lock_release (&d->lock);
+      if (b == NULL)
+        return NULL;
+      p = b;
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
-  lock_release (&d->lock);
-  return b;
+  if (kmem_track)
+    kmem_track_alloc (p, size, site);
+  return p;
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -167,7 +268,7 @@ calloc (size_t a, size_t b)
     return NULL;
 
   /* Allocate and zero memory. */
-  p = malloc (size);
+  p = do_malloc (size, __builtin_return_address (0));
   if (p != NULL)
     memset (p, 0, size);
 
@@ -201,7 +302,8 @@ realloc (void *old_block, size_t new_size)
     }
   else 
     {
-      void *new_block = malloc (new_size);
+      void *new_block = do_malloc (new_size,
+                                   __builtin_return_address (0));
       if (old_block != NULL && new_block != NULL)
         {
           size_t old_size = block_size (old_block);
@@ -223,6 +325,9 @@ free (void *p)
       struct block *b = p;
       struct arena *a = block_to_arena (b);
       struct desc *d = a->desc;
+
+      if (kmem_track)
+        kmem_track_free (p);
       
       if (d != NULL) 
         {
@@ -233,30 +338,31 @@ free (void *p)
           memset (b, 0xcc, d->block_size);
 #endif
   
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
-
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          if (malloc_magazines) 
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              struct malloc_mag *m = &thread_current ()->mags[d - descs];
+              struct mag_block *mb = p;
+
+              ASSERT (!intr_context ());
+              mb->next = m->top;
+              m->top = mb;
+              if (++m->cnt > MAG_MAX)
+                mag_drain (d, m, MAG_BATCH);
+              return;
             }
 
+          lock_acquire (&d->lock);
+          desc_put (d, b);
           lock_release (&d->lock);
         }
       else
         {
           /* It's a big block.  Free its pages. */
+          enum intr_level old_level = intr_disable ();
+          big_cnt--;
+          big_pages -= a->free_cnt;
+          intr_set_level (old_level);
+
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
@@ -292,3 +398,110 @@ arena_to_block (struct arena *a, size_t idx)
                            + sizeof *a
                            + idx * a->desc->block_size);
 }
+
+/* Obtains a free block from descriptor D, creating a new arena
+   if D has no free blocks.  Returns a null pointer if memory is
+   not available.  D's lock must be held. */
+static struct block *
+desc_get (struct desc *d) 
+{
+  struct block *b;
+  struct arena *a;
+
+  /* If the free list is empty, create a new arena. */
+  if (list_empty (&d->free_list))
+    {
+      size_t i;
+
+      /* Allocate a page. */
+      a = palloc_get_page (0);
+      if (a == NULL) 
+        return NULL; 
+
+      /* Initialize arena and add its blocks to the free list. */
+      a->magic = ARENA_MAGIC;
+      a->desc = d;
+      a->free_cnt = d->blocks_per_arena;
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_push_back (&d->free_list, &b->free_elem);
+        }
+      if (++d->arena_cnt > d->peak_arenas)
+        d->peak_arenas = d->arena_cnt;
+    }
+
+  /* Get a block from free list and return it. */
+  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
+  a = block_to_arena (b);
+  a->free_cnt--;
+  d->in_use++;
+  return b;
+}
+
+/* Returns block B to descriptor D, and frees its arena if that
+   leaves the arena entirely unused.  D's lock must be held. */
+static void
+desc_put (struct desc *d, struct block *b) 
+{
+  struct arena *a = block_to_arena (b);
+
+  /* Add block to free list. */
+  list_push_front (&d->free_list, &b->free_elem);
+  d->in_use--;
+
+  /* If the arena is now entirely unused, free it. */
+  if (++a->free_cnt >= d->blocks_per_arena) 
+    {
+      size_t i;
+
+      ASSERT (a->free_cnt == d->blocks_per_arena);
+      for (i = 0; i < d->blocks_per_arena; i++) 
+        {
+          struct block *b = arena_to_block (a, i);
+          list_remove (&b->free_elem);
+        }
+      d->arena_cnt--;
+      palloc_free_page (a);
+    }
+}
+
+/* Moves up to MAG_BATCH blocks from descriptor D into magazine
+   M, which must be empty. */
+static void
+mag_refill (struct desc *d, struct malloc_mag *m) 
+{
+  ASSERT (m->cnt == 0);
+
+  lock_acquire (&d->lock);
+  while (m->cnt < MAG_BATCH) 
+    {
+      struct mag_block *mb = (struct mag_block *) desc_get (d);
+      if (mb == NULL)
+        break;
+      mb->next = m->top;
+      m->top = mb;
+      m->cnt++;
+    }
+  lock_release (&d->lock);
+}
+
+/* Moves CNT blocks from magazine M back to descriptor D. */
+static void
+mag_drain (struct desc *d, struct malloc_mag *m, size_t cnt) 
+{
+  ASSERT (cnt <= m->cnt);
+
+  if (cnt == 0)
+    return;
+  lock_acquire (&d->lock);
+  while (cnt-- > 0) 
+    {
+      struct mag_block *mb = m->top;
+
+      m->top = mb->next;
+      m->cnt--;
+      desc_put (d, (struct block *) mb);
+    }
+  lock_release (&d->lock);
+}
@@ -2,9 +2,28 @@
 #define THREADS_MALLOC_H
 
 #include <debug.h>
+#include <stdbool.h>
 #include <stddef.h>
 
+/* Number of block sizes that malloc() serves from arenas. */
+#define MALLOC_CLASS_CNT 7
+
+/* A thread's magazine for one block size: a stack of free
+   blocks that malloc() and free() use without locking. */
+struct malloc_mag
+  {
+    void *top;                  /* Most recently freed block. */
+    unsigned cnt;               /* Number of blocks. */
+  };
+
+/* Use magazines?  On by default. */
+extern bool malloc_magazines;
+
 void malloc_init (void);
+void malloc_thread_exit (void);
+
+struct kmem_stats;
+void malloc_get_stats (struct kmem_stats *);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
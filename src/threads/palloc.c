@@ -2,11 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <kmem-stat.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
+#include "threads/kmem.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -21,27 +25,148 @@
    that the kernel needs to have memory for its own operations
    even if user processes are swapping like mad.
 
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   The split between the pools is not fixed.  Free memory is
+   divided into "chunks" of CHUNK_PAGES pages, each owned by one
+   pool or by a shared reservoir.  The kernel pool starts out
+   with a guaranteed reserve of about 1/KERNEL_RESERVE_DIV of
+   memory, which it never gives up; everything else starts in
+   the reservoir.  A pool that runs out of pages borrows chunks
+   from the reservoir, and a pool with more than POOL_KEEP free
+   pages gives whole free chunks back.  When the reservoir runs
+   dry, the pool that needs memory takes back the other pool's
+   free chunks, and when it falls below RESERVOIR_LOW pages, the
+   reclaim functions registered with palloc_register_reclaim()
+   are called to shrink kernel caches.  The -ul option limits the
+   number of pages allocated from the user pool at once.
+
+   Within a pool, pages are managed by a binary buddy allocator.
+   Free memory is kept as blocks of 2**ORDER pages, each aligned
+   to its own size in physical memory, on one free list per
+   order.  A request for N pages takes a block of the smallest
+   order that holds N, splitting a larger block in halves if
+   necessary, and gives back the unused tail.  A freed block is
+   merged with its "buddy", the other half of the block of the
+   next larger order, for as long as the buddy is free too and
+   belongs to the same pool.  Both take time logarithmic in the
+   size of memory.  A bitmap of used pages is kept alongside, to
+   catch bad frees.
+
+   Zeroing a page takes longer than allocating it, so each pool
+   also keeps up to ZEROED_MAX free pages that are known to be
+   zero on a separate list, outside the buddy allocator.  The
+   idle thread fills the list by calling palloc_zero_idle(), and
+   single-page PAL_ZERO requests take pages from it without a
+   memset.  Other requests fall back on the list only when the
+   buddy allocator cannot satisfy them.
+
+   Pools are protected by disabling interrupts rather than by a
+   lock, because thread_schedule_tail() frees the pages of dying
+   threads with interrupts off. */
+
+/* Number of block orders.  A block of order ORDER_CNT - 1 is
+   1 GB, larger than all of memory can be. */
+#define ORDER_CNT 19
+
+/* Chunks, the unit in which pools borrow memory from the
+   reservoir, are blocks of this order: 64 pages, or 256 kB. */
+#define CHUNK_ORDER 6
+#define CHUNK_PAGES ((size_t) 1 << CHUNK_ORDER)
+
+/* The kernel pool's guaranteed reserve is 1/KERNEL_RESERVE_DIV
+   of memory, rounded up to whole chunks. */
+#define KERNEL_RESERVE_DIV 8
+
+/* Free pages a pool keeps before giving chunks back. */
+#define POOL_KEEP (2 * CHUNK_PAGES)
+
+/* Free pages in the reservoir below which kernel caches are
+   asked to shrink. */
+#define RESERVOIR_LOW (4 * CHUNK_PAGES)
+
+/* Most reclaim functions that can be registered. */
+#define RECLAIM_MAX 4
+
+/* Most pre-zeroed pages that each pool keeps. */
+#define ZEROED_MAX 64
+
+/* Per-page bookkeeping.  Only the first page of a free block
+   has FREE set; its ORDER gives the block's size and ELEM links
+   it into its pool's free list for that order.  A pre-zeroed
+   page is not FREE, and ELEM links it into its pool's ZEROED
+   list. */
+struct page_info
+  {
+    struct list_elem elem;              /* Free list element. */
+    uint8_t order;                      /* Order of free block. */
+    bool free;                          /* First page of a free block? */
+  };
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
-    uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+    struct list free_lists[ORDER_CNT];  /* Free blocks by order. */
+    size_t page_cnt;                    /* Pages owned. */
+    size_t free_cnt;                    /* Pages in FREE_LISTS. */
+    size_t used_cnt;                    /* Pages allocated. */
+    size_t peak_used;                   /* Most pages ever allocated. */
+    size_t min_pages;                   /* Never own fewer pages. */
+    size_t used_limit;                  /* Never allocate more pages. */
+    struct list zeroed;                 /* Free pages known to be zero. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+
+    /* Statistics. */
+    uint64_t borrowed;                  /* Chunks taken from reservoir. */
+    uint64_t returned;                  /* Chunks given back. */
+    uint64_t zero_hits;                 /* PAL_ZERO served from ZEROED. */
+    uint64_t zero_misses;               /* PAL_ZERO that needed memset. */
+    uint64_t idle_zeroed;               /* Pages zeroed by idle thread. */
   };
 
-/* Two pools: one for kernel data, one for user pages. */
-static struct pool kernel_pool, user_pool;
+/* Two pools: one for kernel data, one for user pages, and the
+   reservoir of chunks that neither is using. */
+static struct pool kernel_pool, user_pool, reservoir;
+
+/* Memory managed by the pools, after the bookkeeping below. */
+static uint8_t *mem_base;               /* First page. */
+static size_t mem_base_no;              /* Page number of MEM_BASE. */
+static size_t mem_page_cnt;             /* Number of pages. */
+static struct bitmap *used_map;         /* Bitmap of free pages. */
+static struct page_info *page_info;     /* One per page. */
+static struct pool **chunk_owner;       /* Owner of each chunk. */
+static size_t first_chunk;              /* Chunk number of CHUNK_OWNER[0]. */
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
-static bool page_from_pool (const struct pool *, void *page);
+/* Functions that shrink kernel caches when memory is short. */
+static palloc_reclaim_func *reclaim_funcs[RECLAIM_MAX];
+static int reclaim_cnt;
+static struct lock reclaim_lock;        /* Serializes reclaiming. */
+static bool reclaim_wanted;             /* Reservoir below RESERVOIR_LOW? */
+
+static void *get_pages (enum palloc_flags, size_t page_cnt,
+                        const void *site);
+static void init_pool (struct pool *, const char *name);
+static void pool_stat (struct pool *, struct kmem_pool_stat *);
+static size_t page_idx (void *page);
+static struct pool *owner (size_t idx);
+static void set_owner (size_t idx, size_t page_cnt, struct pool *);
+static size_t try_alloc (struct pool *, size_t page_cnt,
+                         bool prefer_zeroed, bool *zeroed);
+static size_t pool_alloc (struct pool *, size_t page_cnt,
+                          bool prefer_zeroed, bool *zeroed);
+static bool pool_borrow (struct pool *, size_t page_cnt);
+static void pool_trim (struct pool *, size_t keep);
+static void reclaim (void);
+static bool zero_one (struct pool *);
+static void flush_zeroed (struct pool *);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_no, size_t page_cnt);
+static void free_block (struct pool *, size_t page_no, int order);
+static void push_block (struct pool *, size_t idx, int order);
+static void remove_block (struct pool *, struct page_info *);
+static int order_for (size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
-   pages are put into the user pool. */
+   pages are allocated from the user pool at once. */
 void
 palloc_init (size_t user_page_limit)
 {
@@ -49,16 +174,66 @@ palloc_init (size_t user_page_limit)
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  size_t bm_size, meta_pages, chunk_cnt, reserve, c;
+
+  /* We'll put the used_map, page_info array, and chunk owner
+     array at the start of free memory.  Calculate the space
+     needed for them and subtract it from the memory to manage. */
+  bm_size = ROUND_UP (bitmap_buf_size (free_pages),
+                      sizeof (struct page_info));
+  meta_pages = DIV_ROUND_UP (bm_size
+                             + sizeof *page_info * free_pages
+                             + sizeof *chunk_owner
+                               * (free_pages / CHUNK_PAGES + 2),
+                             PGSIZE);
+  if (meta_pages >= free_pages)
+    PANIC ("Not enough memory for page allocator bitmap.");
+  mem_page_cnt = free_pages - meta_pages;
+  mem_base = free_start + meta_pages * PGSIZE;
+  mem_base_no = pg_no (mem_base);
+  used_map = bitmap_create_in_buf (mem_page_cnt, free_start, bm_size);
+  page_info = (struct page_info *) (free_start + bm_size);
+  memset (page_info, 0, sizeof *page_info * mem_page_cnt);
+  chunk_owner = (struct pool **) (page_info + free_pages);
+  first_chunk = mem_base_no / CHUNK_PAGES;
+  chunk_cnt = (DIV_ROUND_UP (mem_base_no + mem_page_cnt, CHUNK_PAGES)
+               - first_chunk);
+
+  init_pool (&kernel_pool, "kernel pool");
+  init_pool (&user_pool, "user pool");
+  init_pool (&reservoir, "reservoir");
+  user_pool.used_limit = user_page_limit;
+  lock_init (&reclaim_lock);
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  /* Give the kernel its reserve, along with the partial chunks at
+     either end of memory, and put the rest in the reservoir. */
+  reserve = ROUND_UP (mem_page_cnt / KERNEL_RESERVE_DIV, CHUNK_PAGES);
+  for (c = 0; c < chunk_cnt; c++) 
+    {
+      size_t start_no = (first_chunk + c) * CHUNK_PAGES;
+      size_t end_no = start_no + CHUNK_PAGES;
+      size_t idx, cnt;
+      struct pool *pool;
+
+      if (start_no < mem_base_no)
+        start_no = mem_base_no;
+      if (end_no > mem_base_no + mem_page_cnt)
+        end_no = mem_base_no + mem_page_cnt;
+      idx = start_no - mem_base_no;
+      cnt = end_no - start_no;
+
+      if (cnt < CHUNK_PAGES || kernel_pool.page_cnt < reserve)
+        pool = &kernel_pool;
+      else
+        pool = &reservoir;
+      set_owner (idx, cnt, pool);
+      pool->page_cnt += cnt;
+      buddy_free (pool, idx, cnt);
+    }
+  kernel_pool.min_pages = kernel_pool.page_cnt;
+
+  printf ("%zu pages available: %zu reserved for kernel, %zu shared.\n",
+          mem_page_cnt, kernel_pool.page_cnt, reservoir.page_cnt);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -66,30 +241,84 @@ palloc_init (size_t user_page_limit)
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.
+
+   If memory is short and the caller may sleep, kernel caches
+   are asked to shrink first. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
+{
+  return get_pages (flags, page_cnt, __builtin_return_address (0));
+}
+
+/* Obtains a single free page and returns its kernel virtual
+   address.
+   If PAL_USER is set, the page is obtained from the user pool,
+   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   then the page is filled with zeros.  If no pages are
+   available, returns a null pointer, unless PAL_ASSERT is set in
+   FLAGS, in which case the kernel panics. */
+void *
+palloc_get_page (enum palloc_flags flags) 
+{
+  return get_pages (flags, 1, __builtin_return_address (0));
+}
+
+/* Does the work of palloc_get_multiple(), which was called from
+   SITE. */
+static void *
+get_pages (enum palloc_flags flags, size_t page_cnt, const void *site)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  bool may_reclaim;
+  enum intr_level old_level;
   void *pages;
   size_t page_idx;
+  bool zeroed;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  may_reclaim = old_level == INTR_ON && !intr_context ();
+  page_idx = try_alloc (pool, page_cnt, flags & PAL_ZERO, &zeroed);
+  if (page_idx == BITMAP_ERROR && may_reclaim) 
+    {
+      intr_set_level (old_level);
+      reclaim ();
+      intr_disable ();
+      page_idx = try_alloc (pool, page_cnt, flags & PAL_ZERO, &zeroed);
+    }
+  if (page_idx != BITMAP_ERROR) 
+    {
+      if (flags & PAL_ZERO)
+        {
+          if (zeroed)
+            pool->zero_hits++;
+          else
+            pool->zero_misses++;
+        }
+      ASSERT (bitmap_none (used_map, page_idx, page_cnt));
+      bitmap_set_multiple (used_map, page_idx, page_cnt, true);
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->peak_used)
+        pool->peak_used = pool->used_cnt;
+    }
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+    pages = mem_base + PGSIZE * page_idx;
   else
     pages = NULL;
 
   if (pages != NULL) 
     {
-      if (flags & PAL_ZERO)
+      if ((flags & PAL_ZERO) && !zeroed)
         memset (pages, 0, PGSIZE * page_cnt);
+      if (kmem_track)
+        kmem_track_alloc (pages, PGSIZE * page_cnt, site);
+      if (reclaim_wanted && may_reclaim)
+        reclaim ();
     }
   else 
     {
@@ -100,45 +329,36 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   return pages;
 }
 
-/* Obtains a single free page and returns its kernel virtual
-   address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the page is filled with zeros.  If no pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
-void *
-palloc_get_page (enum palloc_flags flags) 
-{
-  return palloc_get_multiple (flags, 1);
-}
-
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
-  size_t page_idx;
+  enum intr_level old_level;
+  size_t idx;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
-
-  page_idx = pg_no (pages) - pg_no (pool->base);
+  idx = page_idx (pages);
+  pool = owner (idx);
+  ASSERT (pool != &reservoir);
+  if (kmem_track)
+    kmem_track_free (pages);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  ASSERT (bitmap_all (used_map, idx, page_cnt));
+  bitmap_set_multiple (used_map, idx, page_cnt, false);
+  pool->used_cnt -= page_cnt;
+  buddy_free (pool, idx, page_cnt);
+  if (pool->free_cnt > POOL_KEEP)
+    pool_trim (pool, POOL_KEEP);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,35 +368,470 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Registers FUNC to be called to free kernel memory when memory
+   runs short.  FUNC should give back whatever memory it can
+   without waiting on locks that an allocating thread might hold,
+   and return the number of pages freed. */
+void
+palloc_register_reclaim (palloc_reclaim_func *func) 
+{
+  ASSERT (reclaim_cnt < RECLAIM_MAX);
+  reclaim_funcs[reclaim_cnt++] = func;
+}
+
+/* Zeroes one free page and adds it to its pool's list of
+   pre-zeroed pages.  Returns true if successful, false if every
+   pool already has ZEROED_MAX pre-zeroed pages or no free pages.
+   Called by the idle thread with interrupts on; the page is
+   zeroed with interrupts on, so this does not delay interrupts
+   by more than a few list operations. */
+bool
+palloc_zero_idle (void) 
+{
+  ASSERT (intr_get_level () == INTR_ON);
+
+  return zero_one (&kernel_pool) || zero_one (&user_pool);
+}
+
+/* Stores the pre-zeroed page statistics for the user pool in S
+   if PAL_USER is set in FLAGS, or for the kernel pool
+   otherwise. */
+void
+palloc_zero_stats (enum palloc_flags flags, struct palloc_zero_stats *s) 
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  s->zeroed_cnt = pool->zeroed_cnt;
+  s->hits = pool->zero_hits;
+  s->misses = pool->zero_misses;
+  s->idle_zeroed = pool->idle_zeroed;
+  intr_set_level (old_level);
+}
+
+/* Stores usage statistics for the kernel and user pools and the
+   reservoir into S. */
+void
+palloc_get_stats (struct kmem_stats *s) 
+{
+  enum intr_level old_level = intr_disable ();
+  pool_stat (&kernel_pool, &s->kernel);
+  pool_stat (&user_pool, &s->user);
+  s->reservoir = reservoir.page_cnt;
+  intr_set_level (old_level);
+}
+
+/* Prints page allocator statistics.  See kmem_print_stats() for
+   memory usage. */
+void
+palloc_print_stats (void) 
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++) 
+    {
+      struct pool *p = pools[i];
+
+      printf ("Palloc: %s: %"PRIu64" chunks borrowed, "
+              "%"PRIu64" returned\n", p->name, p->borrowed, p->returned);
+      printf ("Palloc: %s: %"PRIu64" zeroed pages used, "
+              "%"PRIu64" zeroed by memset, %"PRIu64" zeroed when idle\n",
+              p->name, p->zero_hits, p->zero_misses, p->idle_zeroed);
+    }
+}
+
+/* Initializes pool P, which owns no pages yet, naming it NAME
+   for statistics. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+init_pool (struct pool *p, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  int order;
 
-  printf ("%zu pages available in %s.\n", page_cnt, name);
+  p->name = name;
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free_lists[order]);
+  p->page_cnt = p->free_cnt = p->used_cnt = p->peak_used = 0;
+  p->min_pages = 0;
+  p->used_limit = SIZE_MAX;
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->borrowed = p->returned = 0;
+  p->zero_hits = p->zero_misses = p->idle_zeroed = 0;
+}
+
+/* Stores usage statistics for pool P into S.  Must be called
+   with interrupts off. */
+static void
+pool_stat (struct pool *p, struct kmem_pool_stat *s) 
+{
+  int order;
 
-  /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  s->pages = p->page_cnt;
+  s->free = p->free_cnt + p->zeroed_cnt;
+  s->used = p->used_cnt;
+  s->peak_used = p->peak_used;
+  s->largest_free = p->zeroed_cnt > 0;
+  for (order = ORDER_CNT - 1; order >= 0; order--)
+    if (!list_empty (&p->free_lists[order])) 
+      {
+        s->largest_free = (size_t) 1 << order;
+        break;
+      }
 }
 
-/* Returns true if PAGE was allocated from POOL,
-   false otherwise. */
-static bool
-page_from_pool (const struct pool *pool, void *page) 
+/* Returns the index of PAGE, which must be managed by the page
+   allocator. */
+static size_t
+page_idx (void *page) 
 {
   size_t page_no = pg_no (page);
-  size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
 
-  return page_no >= start_page && page_no < end_page;
+  ASSERT (page_no >= mem_base_no && page_no < mem_base_no + mem_page_cnt);
+  return page_no - mem_base_no;
+}
+
+/* Returns the pool that owns the page with index IDX. */
+static struct pool *
+owner (size_t idx) 
+{
+  return chunk_owner[(mem_base_no + idx) / CHUNK_PAGES - first_chunk];
+}
+
+/* Makes POOL the owner of the PAGE_CNT pages starting at index
+   IDX, which must be whole chunks unless they are at either end
+   of memory. */
+static void
+set_owner (size_t idx, size_t page_cnt, struct pool *pool) 
+{
+  size_t c = (mem_base_no + idx) / CHUNK_PAGES - first_chunk;
+  size_t end = (DIV_ROUND_UP (mem_base_no + idx + page_cnt, CHUNK_PAGES)
+                - first_chunk);
+
+  for (; c < end; c++)
+    chunk_owner[c] = pool;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL, as pool_alloc(),
+   borrowing from the reservoir if necessary, unless that would
+   exceed POOL's limit.  Returns the index of the first page, or
+   BITMAP_ERROR if none are available.  Must be called with
+   interrupts off. */
+static size_t
+try_alloc (struct pool *pool, size_t page_cnt, bool prefer_zeroed,
+           bool *zeroed) 
+{
+  size_t idx;
+
+  *zeroed = false;
+  if (page_cnt > pool->used_limit - pool->used_cnt)
+    return BITMAP_ERROR;
+  idx = pool_alloc (pool, page_cnt, prefer_zeroed, zeroed);
+  if (idx == BITMAP_ERROR && pool_borrow (pool, page_cnt))
+    idx = pool_alloc (pool, page_cnt, prefer_zeroed, zeroed);
+  return idx;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if none are available.  A
+   single page comes from the pre-zeroed list if PREFER_ZEROED is
+   true or the buddy allocator is out of pages.  Sets *ZEROED to
+   whether the pages returned are known to be zero.  Must be
+   called with interrupts off. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt, bool prefer_zeroed,
+            bool *zeroed) 
+{
+  size_t idx;
+
+  *zeroed = false;
+  if (page_cnt == 1 && !prefer_zeroed) 
+    {
+      idx = buddy_alloc (pool, 1);
+      if (idx != BITMAP_ERROR)
+        return idx;
+    }
+  if (page_cnt == 1 && pool->zeroed_cnt > 0) 
+    {
+      idx = list_entry (list_pop_front (&pool->zeroed),
+                        struct page_info, elem) - page_info;
+      pool->zeroed_cnt--;
+      *zeroed = true;
+      return idx;
+    }
+
+  idx = buddy_alloc (pool, page_cnt);
+  if (idx == BITMAP_ERROR && pool->zeroed_cnt > 0) 
+    {
+      /* The pre-zeroed pages may be keeping blocks from merging
+         into one large enough. */
+      flush_zeroed (pool);
+      idx = buddy_alloc (pool, page_cnt);
+    }
+  return idx;
+}
+
+/* Moves enough chunks from the reservoir to POOL to hold a block
+   of PAGE_CNT pages, taking back the other pool's free chunks if
+   the reservoir is short.  Returns true if successful, false if
+   there is not enough free memory.  Must be called with
+   interrupts off. */
+static bool
+pool_borrow (struct pool *pool, size_t page_cnt) 
+{
+  struct pool *other = pool == &kernel_pool ? &user_pool : &kernel_pool;
+  size_t want = (size_t) 1 << order_for (page_cnt);
+  size_t idx;
+
+  if (want < CHUNK_PAGES)
+    want = CHUNK_PAGES;
+  idx = buddy_alloc (&reservoir, want);
+  if (idx == BITMAP_ERROR) 
+    {
+      pool_trim (other, 0);
+      idx = buddy_alloc (&reservoir, want);
+    }
+  if (idx == BITMAP_ERROR || reservoir.free_cnt < RESERVOIR_LOW)
+    reclaim_wanted = true;
+  if (idx == BITMAP_ERROR)
+    return false;
+
+  set_owner (idx, want, pool);
+  reservoir.page_cnt -= want;
+  pool->page_cnt += want;
+  pool->borrowed += want / CHUNK_PAGES;
+  buddy_free (pool, idx, want);
+  return true;
+}
+
+/* Gives POOL's free whole chunks back to the reservoir, largest
+   blocks first, until POOL has no more than KEEP free pages or
+   owns only its guaranteed minimum.  If KEEP is 0, also gives up
+   POOL's pre-zeroed pages, which may be keeping chunks from
+   coming together.  Must be called with interrupts off. */
+static void
+pool_trim (struct pool *pool, size_t keep) 
+{
+  int order;
+
+  ASSERT (pool != &reservoir);
+
+  if (keep == 0)
+    flush_zeroed (pool);
+  for (order = ORDER_CNT - 1; order >= CHUNK_ORDER; order--)
+    while (!list_empty (&pool->free_lists[order])
+           && pool->free_cnt > keep
+           && pool->page_cnt >= pool->min_pages + CHUNK_PAGES) 
+      {
+        struct page_info *info = list_entry (list_front (&pool->free_lists[order]),
+                                             struct page_info, elem);
+        size_t idx = info - page_info;
+        size_t cnt = (size_t) 1 << order;
+        size_t give = ROUND_DOWN (pool->page_cnt - pool->min_pages,
+                                  CHUNK_PAGES);
+
+        if (give > cnt)
+          give = cnt;
+        remove_block (pool, info);
+        if (give < cnt)
+          buddy_free (pool, idx + give, cnt - give);
+
+        set_owner (idx, give, &reservoir);
+        pool->page_cnt -= give;
+        reservoir.page_cnt += give;
+        pool->returned += give / CHUNK_PAGES;
+        buddy_free (&reservoir, idx, give);
+      }
+}
+
+/* Calls the registered reclaim functions to shrink kernel
+   caches, then gives the kernel pool's free chunks beyond its
+   reserve back to the reservoir.  Does nothing if another thread
+   is already reclaiming.  Must be called with interrupts on,
+   outside an interrupt handler. */
+static void
+reclaim (void) 
+{
+  enum intr_level old_level;
+  int i;
+
+  if (!lock_try_acquire (&reclaim_lock))
+    return;
+  reclaim_wanted = false;
+  for (i = 0; i < reclaim_cnt; i++)
+    reclaim_funcs[i] ();
+
+  old_level = intr_disable ();
+  pool_trim (&kernel_pool, 0);
+  intr_set_level (old_level);
+  lock_release (&reclaim_lock);
+}
+
+/* Zeroes a page from POOL's buddy allocator and adds it to
+   POOL's pre-zeroed list, unless that list is full or POOL has
+   no free pages.  Returns true if a page was zeroed.  Must be
+   called with interrupts on. */
+static bool
+zero_one (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t idx;
+
+  old_level = intr_disable ();
+  idx = pool->zeroed_cnt < ZEROED_MAX ? buddy_alloc (pool, 1) : BITMAP_ERROR;
+  intr_set_level (old_level);
+  if (idx == BITMAP_ERROR)
+    return false;
+
+  /* The page belongs to no one while we zero it. */
+  memset (mem_base + PGSIZE * idx, 0, PGSIZE);
+
+  old_level = intr_disable ();
+  list_push_back (&pool->zeroed, &page_info[idx].elem);
+  pool->zeroed_cnt++;
+  pool->idle_zeroed++;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Returns all of POOL's pre-zeroed pages to its buddy allocator.
+   Must be called with interrupts off. */
+static void
+flush_zeroed (struct pool *pool) 
+{
+  while (!list_empty (&pool->zeroed)) 
+    {
+      size_t idx = list_entry (list_pop_front (&pool->zeroed),
+                               struct page_info, elem) - page_info;
+      free_block (pool, idx, 0);
+    }
+  pool->zeroed_cnt = 0;
+}
+
+/* Buddy allocator.
+
+   These functions take page indexes from 0 to MEM_PAGE_CNT, but
+   align blocks by physical page number, so that a block of order
+   N starts at a multiple of 2**N pages in physical memory.  They
+   must be called with interrupts off. */
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) 
+{
+  int order = order_for (page_cnt);
+  int cur;
+  size_t idx;
+
+  /* Find the smallest free block that is large enough. */
+  for (cur = order; cur < ORDER_CNT; cur++)
+    if (!list_empty (&pool->free_lists[cur]))
+      break;
+  if (cur >= ORDER_CNT)
+    return BITMAP_ERROR;
+  idx = list_entry (list_front (&pool->free_lists[cur]),
+                    struct page_info, elem) - page_info;
+  remove_block (pool, &page_info[idx]);
+
+  /* Split it down to the order needed, freeing the upper half
+     each time. */
+  while (cur > order) 
+    {
+      cur--;
+      push_block (pool, idx + ((size_t) 1 << cur), cur);
+    }
+
+  /* Give back what we don't need. */
+  buddy_free (pool, idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return idx;
+}
+
+/* Frees the PAGE_CNT pages starting at index IDX in POOL, as the
+   largest aligned blocks that they contain. */
+static void
+buddy_free (struct pool *pool, size_t idx, size_t page_cnt) 
+{
+  while (page_cnt > 0) 
+    {
+      size_t page_no = mem_base_no + idx;
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_no % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      free_block (pool, idx, order);
+      idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Frees the block of 2**ORDER pages starting at index IDX in
+   POOL, merging it with its buddy for as long as possible.  A
+   buddy in another chunk may belong to another pool. */
+static void
+free_block (struct pool *pool, size_t idx, int order) 
+{
+  while (order + 1 < ORDER_CNT) 
+    {
+      size_t page_no = mem_base_no + idx;
+      size_t buddy_no = page_no ^ ((size_t) 1 << order);
+      size_t buddy_idx = buddy_no - mem_base_no;
+      struct page_info *buddy;
+
+      if (buddy_no < mem_base_no
+          || buddy_no >= mem_base_no + mem_page_cnt)
+        break;
+      buddy = &page_info[buddy_idx];
+      if (!buddy->free || buddy->order != order
+          || (order >= CHUNK_ORDER && owner (buddy_idx) != pool))
+        break;
+
+      remove_block (pool, buddy);
+      if (buddy_no < page_no)
+        idx = buddy_idx;
+      order++;
+    }
+
+  push_block (pool, idx, order);
+}
+
+/* Adds the block of 2**ORDER pages starting at index IDX to
+   POOL's free lists. */
+static void
+push_block (struct pool *pool, size_t idx, int order) 
+{
+  struct page_info *info = &page_info[idx];
+
+  info->order = order;
+  info->free = true;
+  list_push_front (&pool->free_lists[order], &info->elem);
+  pool->free_cnt += (size_t) 1 << order;
+}
+
+/* Removes the free block whose first page is described by INFO
+   from POOL's free lists. */
+static void
+remove_block (struct pool *pool, struct page_info *info) 
+{
+  ASSERT (info->free);
+
+  list_remove (&info->elem);
+  info->free = false;
+  pool->free_cnt -= (size_t) 1 << info->order;
+}
+
+/* Returns the smallest order of block that holds PAGE_CNT
+   pages. */
+static int
+order_for (size_t page_cnt) 
+{
+  int order = 0;
+
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
 }
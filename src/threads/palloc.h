@@ -1,7 +1,9 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* How to allocate pages. */
 enum palloc_flags
@@ -16,5 +18,26 @@ void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_zero_idle (void);
+
+/* Frees kernel memory when memory runs short.  Returns the
+   number of pages freed. */
+typedef size_t palloc_reclaim_func (void);
+void palloc_register_reclaim (palloc_reclaim_func *);
+
+/* Statistics for a pool's pre-zeroed pages. */
+struct palloc_zero_stats
+  {
+    size_t zeroed_cnt;          /* Pre-zeroed pages available now. */
+    uint64_t hits;              /* PAL_ZERO pages served pre-zeroed. */
+    uint64_t misses;            /* PAL_ZERO requests that used memset. */
+    uint64_t idle_zeroed;       /* Pages zeroed by the idle thread. */
+  };
+
+void palloc_zero_stats (enum palloc_flags, struct palloc_zero_stats *);
+
+struct kmem_stats;
+void palloc_get_stats (struct kmem_stats *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
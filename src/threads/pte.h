@@ -51,7 +51,11 @@ static inline uintptr_t pd_no (const void *va) {
    |         Physical Address           |         Flags          |
    +------------------------------------+------------------------+
 
-   In a PDE, the physical address points to a page table.
+   In a PDE, the physical address points to a page table, unless
+   PTE_PS is set, in which case the PDE maps a 4 MB "large page"
+   directly, without a page table, and its physical address must
+   be a multiple of 4 MB.  Large pages need the PSE feature of
+   the CPU to be enabled in CR4; see paging_init().
    In a PTE, the physical address points to a data or code page.
    The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
@@ -66,6 +70,8 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PDE_LARGE_ADDR 0xffc00000 /* Address bits of a large-page PDE. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -77,9 +83,35 @@ static inline uint32_t pde_create (uint32_t *pt) {
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
+/* Returns a PDE that maps the 4 MB large page at PAGE, which
+   must be 4 MB aligned in physical memory.
+   The page is readable.
+   If WRITABLE is true then it will be writable as well.
+   The page will be usable only by ring 0 code (the kernel). */
+static inline uint32_t pde_create_large (void *page, bool writable) {
+  ASSERT ((vtop (page) & ~PDE_LARGE_ADDR) == 0);
+  return vtop (page) | PTE_PS | PTE_P | (writable ? PTE_W : 0);
+}
+
+/* Returns a PDE that maps the 4 MB large page at PAGE, as
+   pde_create_large(), but usable by both user and kernel
+   code. */
+static inline uint32_t pde_create_large_user (void *page, bool writable) {
+  return pde_create_large (page, writable) | PTE_U;
+}
+
+/* Returns a pointer to the large page that page directory entry
+   PDE, which must have PTE_PS set, maps.  PDE need not be
+   present. */
+static inline void *pde_get_large_page (uint32_t pde) {
+  ASSERT (pde & PTE_PS);
+  return ptov (pde & PDE_LARGE_ADDR);
+}
+
 /* Returns a PTE that points to PAGE.
    The PTE's page is readable.
    If WRITABLE is true then it will be writable as well.
@@ -0,0 +1,101 @@
+#include "threads/sched-trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Ring buffer of the most recent scheduling decisions.
+
+   schedule() is the only writer.  It runs with interrupts off,
+   so it is never interrupted by a reader.  It claims the slot
+   for event number N by advancing trace_head past N before
+   filling it in, so a reader that samples trace_head after
+   copying can tell which of its copies may have been
+   overwritten meanwhile and drop them, without taking a lock or
+   keeping schedule() waiting. */
+static struct sched_event trace[SCHED_TRACE_SIZE];
+static unsigned trace_head;     /* Number of events recorded. */
+
+/* See sched-trace.h. */
+bool sched_trace_dump;
+
+/* Records that schedule() chose NEXT to run after PREV at TIME,
+   leaving READY_CNT threads ready.  Interrupts must be off. */
+void
+sched_trace_record (const struct thread *prev, const struct thread *next,
+                    int64_t time, int ready_cnt) 
+{
+  struct sched_event *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  e = &trace[trace_head++ % SCHED_TRACE_SIZE];
+  barrier ();
+  e->time = time;
+  e->prev = prev->tid;
+  e->next = next->tid;
+  e->prev_status = prev->status;
+  e->prev_priority = prev->priority;
+  e->next_priority = next->priority;
+  e->ready_cnt = ready_cnt < UINT8_MAX ? ready_cnt : UINT8_MAX;
+}
+
+/* Copies up to MAX_CNT of the most recent scheduling events into
+   EVENTS, oldest first, and returns the number copied.  Does not
+   block schedule(), so it may be called with interrupts on. */
+size_t
+sched_trace_read (struct sched_event *events, size_t max_cnt) 
+{
+  unsigned head, first, last, i;
+
+  head = trace_head;
+  barrier ();
+  first = head - (head < SCHED_TRACE_SIZE ? head : SCHED_TRACE_SIZE);
+  if (head - first > max_cnt)
+    first = head - max_cnt;
+  for (i = first; i != head; i++)
+    events[i - first] = trace[i % SCHED_TRACE_SIZE];
+  barrier ();
+
+  /* Drop events whose slots were claimed again while we
+     copied. */
+  last = trace_head;
+  if (last - first > SCHED_TRACE_SIZE) 
+    {
+      unsigned lost = last - first - SCHED_TRACE_SIZE;
+      if (lost > head - first)
+        lost = head - first;
+      for (i = lost; i < head - first; i++)
+        events[i - lost] = events[i];
+      first += lost;
+    }
+  return head - first;
+}
+
+/* Prints the trace, oldest event first. */
+void
+sched_trace_print (void) 
+{
+  static const char *status_names[] =
+    {"running", "ready", "blocked", "dying"};
+  struct sched_event *events;
+  size_t cnt, i;
+
+  events = malloc (sizeof *events * SCHED_TRACE_SIZE);
+  if (events == NULL)
+    return;
+  cnt = sched_trace_read (events, SCHED_TRACE_SIZE);
+
+  printf ("Scheduler trace: last %zu of %u events\n", cnt, trace_head);
+  for (i = 0; i < cnt; i++) 
+    {
+      struct sched_event *e = &events[i];
+      printf ("  %10"PRId64" us: %d (%s, pri %d) -> %d (pri %d), "
+              "%d ready\n",
+              e->time / 1000, e->prev, status_names[e->prev_status],
+              e->prev_priority, e->next, e->next_priority, e->ready_cnt);
+    }
+  free (events);
+}
@@ -0,0 +1,34 @@
+#ifndef THREADS_SCHED_TRACE_H
+#define THREADS_SCHED_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Number of events kept in the trace.  Must be a power of 2. */
+#define SCHED_TRACE_SIZE 256
+
+/* One scheduling decision, recorded by schedule(). */
+struct sched_event
+  {
+    int64_t time;               /* timer_ns() at the decision. */
+    tid_t prev;                 /* Thread that stopped running. */
+    tid_t next;                 /* Thread chosen to run. */
+    uint8_t prev_status;        /* PREV's new state. */
+    uint8_t prev_priority;      /* PREV's priority. */
+    uint8_t next_priority;      /* NEXT's priority. */
+    uint8_t ready_cnt;          /* Threads left ready, capped at 255. */
+  };
+
+/* Print the trace at shutdown?
+   Controlled by kernel command-line option "-schedtrace". */
+extern bool sched_trace_dump;
+
+void sched_trace_record (const struct thread *prev,
+                         const struct thread *next,
+                         int64_t time, int ready_cnt);
+size_t sched_trace_read (struct sched_event *, size_t max_cnt);
+void sched_trace_print (void);
+
+#endif /* threads/sched-trace.h */
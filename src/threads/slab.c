@@ -0,0 +1,344 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Slab object caches.
+
+   malloc() rounds every request up to a power of 2, so an object
+   a little over a power of 2 in size wastes almost half its
+   block, and it gives an arena back to the page allocator the
+   moment its last block is freed.  A slab cache instead hands
+   out objects of exactly one size, packed into one-page slabs,
+   and keeps slabs that become empty for reuse.
+
+   Each slab begins with a struct slab, followed by an array that
+   links its free objects by index, followed by the objects.
+   Objects on the free list are not written to, so an object
+   freed in the state its constructor left it in is handed out
+   again in that state without running the constructor again.
+
+   A cache keeps its slabs on three lists: partial, full, and
+   empty.  Allocation prefers a partial slab, then an empty one,
+   and only then a new page.  Up to EMPTY_KEEP empty slabs stay
+   with each cache; others go back to the page allocator at once,
+   and slab_reclaim() returns the rest when memory runs short.
+   The page allocator calls slab_reclaim() itself when its
+   reservoir runs low. */
+
+/* Empty slabs that each cache keeps. */
+#define EMPTY_KEEP 2
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* No free object. */
+#define FREE_END UINT16_MAX
+
+/* Header at the start of each slab. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of cache's lists. */
+    size_t in_use;              /* Objects allocated. */
+    uint16_t free;              /* Index of first free object. */
+    uint16_t next[];            /* Index of next free object. */
+  };
+
+/* All caches, for statistics and reclaim. */
+static struct list all_caches;
+static struct lock all_caches_lock;
+
+static struct slab *slab_create (struct slab_cache *);
+static void slab_destroy (struct slab *);
+static struct slab *obj_to_slab (struct slab_cache *, void *);
+static void *slab_obj (struct slab *, size_t idx);
+
+/* Initializes the slab allocator. */
+void
+slab_init (void)
+{
+  list_init (&all_caches);
+  lock_init_named (&all_caches_lock, "slab caches");
+  palloc_register_reclaim (slab_reclaim);
+}
+
+/* Initializes cache C, named NAME, to allocate objects of SIZE
+   bytes aligned on ALIGN-byte boundaries, or on pointer size if
+   ALIGN is 0.  If CTOR is non-null, it is called on each object
+   once, when its slab is created. */
+void
+slab_cache_init (struct slab_cache *c, const char *name,
+                 size_t size, size_t align, slab_ctor_func *ctor)
+{
+  size_t cnt;
+
+  if (align == 0)
+    align = sizeof (void *);
+  ASSERT ((align & (align - 1)) == 0);
+  ASSERT (size > 0);
+
+  c->name = name;
+  c->obj_size = ROUND_UP (size, align);
+  c->ctor = ctor;
+
+  /* Fit as many objects as we can along with their header. */
+  for (cnt = PGSIZE / c->obj_size; cnt > 0; cnt--)
+    {
+      size_t ofs = ROUND_UP (sizeof (struct slab)
+                             + sizeof (uint16_t) * cnt, align);
+      if (ofs + cnt * c->obj_size <= PGSIZE)
+        {
+          c->obj_ofs = ofs;
+          break;
+        }
+    }
+  if (cnt == 0)
+    PANIC ("%zu-byte objects of slab cache %s do not fit in a page",
+           size, name);
+  if (cnt > FREE_END)
+    cnt = FREE_END;
+  c->objs_per_slab = cnt;
+
+  lock_init_named (&c->lock, name);
+  list_init (&c->partial);
+  list_init (&c->full);
+  list_init (&c->empty);
+  c->empty_cnt = 0;
+  c->slab_cnt = c->in_use = c->peak_in_use = 0;
+  c->alloc_cnt = c->slab_alloc_cnt = 0;
+
+  lock_acquire (&all_caches_lock);
+  list_push_back (&all_caches, &c->elem);
+  lock_release (&all_caches_lock);
+}
+
+/* Allocates and returns an object from cache C, or a null
+   pointer if no memory is available. */
+void *
+slab_alloc (struct slab_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  c->alloc_cnt++;
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else if (!list_empty (&c->empty))
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      c->empty_cnt--;
+      list_push_front (&c->partial, &s->elem);
+    }
+  else
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          /* Try again after taking back other caches' empty
+             slabs. */
+          lock_release (&c->lock);
+          if (slab_reclaim () == 0)
+            return NULL;
+          lock_acquire (&c->lock);
+          s = slab_create (c);
+          if (s == NULL)
+            {
+              lock_release (&c->lock);
+              return NULL;
+            }
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  /* Take its first free object. */
+  ASSERT (s->free != FREE_END);
+  obj = slab_obj (s, s->free);
+  s->free = s->next[s->free];
+  if (++s->in_use == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+  if (++c->in_use > c->peak_in_use)
+    c->peak_in_use = c->in_use;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from cache C, to
+   C.  If C has a constructor, OBJ must be in the state that it
+   leaves objects in. */
+void
+slab_free (struct slab_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  idx = ((uint8_t *) obj - (uint8_t *) s - c->obj_ofs) / c->obj_size;
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  ASSERT (s->in_use > 0);
+  s->next[idx] = s->free;
+  s->free = idx;
+  c->in_use--;
+  if (s->in_use-- == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  if (s->in_use == 0)
+    {
+      list_remove (&s->elem);
+      if (c->empty_cnt < EMPTY_KEEP)
+        {
+          list_push_front (&c->empty, &s->elem);
+          c->empty_cnt++;
+        }
+      else
+        slab_destroy (s);
+    }
+  lock_release (&c->lock);
+}
+
+/* Gives every cache's empty slabs back to the page allocator.
+   Returns the number of pages freed.  Skips caches that are busy,
+   including one whose lock the running thread holds, because the
+   page allocator may call this from slab_create() with that
+   cache's lock held. */
+size_t
+slab_reclaim (void)
+{
+  struct list_elem *e;
+  size_t cnt = 0;
+
+  if (!lock_try_acquire (&all_caches_lock))
+    return 0;
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+
+      if (lock_held_by_current_thread (&c->lock)
+          || !lock_try_acquire (&c->lock))
+        continue;
+      while (!list_empty (&c->empty))
+        {
+          slab_destroy (list_entry (list_pop_front (&c->empty),
+                                    struct slab, elem));
+          c->empty_cnt--;
+          cnt++;
+        }
+      lock_release (&c->lock);
+    }
+  lock_release (&all_caches_lock);
+
+  return cnt;
+}
+
+/* Prints statistics for each cache that has been used. */
+void
+slab_print_stats (void)
+{
+  struct list_elem *e;
+
+  if (list_empty (&all_caches))
+    return;
+
+  printf ("Slab: %-12s %6s %6s %8s %8s %10s %6s\n", "cache", "size",
+          "per", "in use", "peak", "allocs", "slabs");
+  lock_acquire (&all_caches_lock);
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct slab_cache *c = list_entry (e, struct slab_cache, elem);
+
+      if (c->alloc_cnt == 0)
+        continue;
+      printf ("Slab: %-12s %6zu %6zu %8zu %8zu %10"PRIu64" %6zu\n",
+              c->name, c->obj_size, c->objs_per_slab, c->in_use,
+              c->peak_in_use, c->alloc_cnt, c->slab_cnt);
+    }
+  lock_release (&all_caches_lock);
+}
+
+/* Obtains a page for a new slab for cache C and prepares its
+   objects.  Returns the new slab, or a null pointer if no memory
+   is available.  C's lock must be held. */
+static struct slab *
+slab_create (struct slab_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free = 0;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      s->next[i] = i + 1 < c->objs_per_slab ? i + 1 : FREE_END;
+      if (c->ctor != NULL)
+        c->ctor (slab_obj (s, i));
+    }
+  c->slab_cnt++;
+  c->slab_alloc_cnt++;
+  return s;
+}
+
+/* Gives slab S, which has no objects in use, back to the page
+   allocator.  Its cache's lock must be held. */
+static void
+slab_destroy (struct slab *s)
+{
+  ASSERT (s->in_use == 0);
+
+  s->cache->slab_cnt--;
+  s->magic = 0;
+  palloc_free_page (s);
+}
+
+/* Returns the slab in cache C that contains OBJ. */
+static struct slab *
+obj_to_slab (struct slab_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and OBJ is properly aligned
+     within it. */
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the object with index IDX in slab S. */
+static void *
+slab_obj (struct slab *s, size_t idx)
+{
+  ASSERT (idx < s->cache->objs_per_slab);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
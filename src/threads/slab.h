@@ -0,0 +1,44 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/synch.h"
+
+/* Prepares a newly allocated object. */
+typedef void slab_ctor_func (void *obj);
+
+/* A cache of objects of a single size and type, carved out of
+   one-page "slabs".  See slab.c for details. */
+struct slab_cache
+  {
+    struct list_elem elem;      /* Element in list of all caches. */
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Object size, including padding. */
+    size_t obj_ofs;             /* Offset of first object in a slab. */
+    size_t objs_per_slab;       /* Objects in each slab. */
+    slab_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects everything below. */
+    struct list partial;        /* Slabs with some objects in use. */
+    struct list full;           /* Slabs with all objects in use. */
+    struct list empty;          /* Slabs with no objects in use. */
+    size_t empty_cnt;           /* Number of slabs in EMPTY. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated now. */
+    size_t in_use;              /* Objects allocated now. */
+    size_t peak_in_use;         /* Most objects ever allocated. */
+    uint64_t alloc_cnt;         /* Calls to slab_alloc(). */
+    uint64_t slab_alloc_cnt;    /* Pages obtained from palloc. */
+  };
+
+void slab_init (void);
+void slab_cache_init (struct slab_cache *, const char *name,
+                      size_t size, size_t align, slab_ctor_func *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+size_t slab_reclaim (void);
+void slab_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -30,7 +30,20 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/lockstat.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Maximum length of a chain of lock holders through which a
+   waiting thread's priority is donated.  Bounds the time spent
+   in lock_acquire() even if lock dependencies form a cycle. */
+#define DONATION_DEPTH 8
+
+static bool priority_less (const struct list_elem *,
+                           const struct list_elem *, void *aux);
+static void init_semaphore (struct semaphore *, unsigned value,
+                            struct lock_class *);
+static void init_lock (struct lock *, struct lock_class *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -40,14 +53,18 @@
      decrement it.
 
    - up or "V": increment the value (and wake up one waiting
-     thread, if any). */
-void
+     thread, if any).
+
+   With lock statistics enabled, semaphores initialized at the
+   same place in the code share statistics. */
+void NO_INLINE
 sema_init (struct semaphore *sema, unsigned value) 
 {
-  ASSERT (sema != NULL);
-
-  sema->value = value;
-  list_init (&sema->waiters);
+  init_semaphore (sema, value,
+                  (lockstat_enabled
+                   ? lockstat_class (NULL, __builtin_return_address (0),
+                                     false)
+                   : NULL));
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -61,17 +78,25 @@ void
 sema_down (struct semaphore *sema) 
 {
   enum intr_level old_level;
+  bool contended;
+  int64_t start = 0;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  contended = sema->value == 0;
+  if (contended && sema->class != NULL)
+    start = timer_ns ();
   while (sema->value == 0) 
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
   sema->value--;
+  if (sema->class != NULL)
+    lockstat_acquired (sema->class, contended,
+                       contended ? timer_ns () - start : 0);
   intr_set_level (old_level);
 }
 
@@ -93,6 +118,8 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true; 
+      if (sema->class != NULL)
+        lockstat_acquired (sema->class, false, 0);
     }
   else
     success = false;
@@ -102,9 +129,13 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  Of equal-priority waiters, the one that has
+   waited longest is woken.
 
-   This function may be called from an interrupt handler. */
+   This function may be called from an interrupt handler.  If the
+   thread woken up has a higher priority than the running thread,
+   the running thread yields to it. */
 void
 sema_up (struct semaphore *sema) 
 {
@@ -114,10 +145,15 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      struct list_elem *e = list_max (&sema->waiters, priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+
+  thread_yield_to_higher ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -172,19 +208,62 @@ sema_test_helper (void *sema_)
    acquire and release it.  When these restrictions prove
    onerous, it's a good sign that a semaphore should be used,
    instead of a lock. */
-void
+void NO_INLINE
 lock_init (struct lock *lock)
 {
-  ASSERT (lock != NULL);
+  init_lock (lock, (lockstat_enabled
+                    ? lockstat_class (NULL, __builtin_return_address (0),
+                                      true)
+                    : NULL));
+}
 
-  lock->holder = NULL;
-  sema_init (&lock->semaphore, 1);
+/* Initializes LOCK like lock_init().  With lock statistics
+   enabled, LOCK shares its statistics with all the other locks
+   named NAME, instead of those initialized at the same place in
+   the code. */
+void
+lock_init_named (struct lock *lock, const char *name) 
+{
+  ASSERT (name != NULL);
+
+  init_lock (lock, lockstat_enabled ? lockstat_class (name, NULL, true) : NULL);
+}
+
+/* Donates the priority of DONOR, which is waiting for a lock,
+   to the holder of that lock, and onward to the holder of any
+   lock that holder is itself waiting for, up to DONATION_DEPTH
+   levels. */
+static void
+donate_priority (struct thread *donor) 
+{
+  int depth;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (depth = 0; depth < DONATION_DEPTH; depth++) 
+    {
+      struct thread *holder;
+
+      if (donor->waiting_lock == NULL)
+        break;
+      holder = donor->waiting_lock->holder;
+      if (holder == NULL || holder->priority >= donor->priority)
+        break;
+      thread_refresh_priority (holder);
+      donor = holder;
+    }
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   While we wait, our priority is donated to the lock's holder
+   (and transitively to whatever it waits for), so that a
+   lower-priority holder cannot be starved by threads of
+   intermediate priority.  Donation is not used under the
+   multi-level feedback queue scheduler.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +271,49 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e;
+  bool contended;
+  int64_t start = 0;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  contended = lock->holder != NULL;
+  if (lock->class != NULL)
+    start = timer_ns ();
+  if (lock->holder != NULL && !thread_mlfqs) 
+    {
+      cur->waiting_lock = lock;
+      list_push_back (&lock->holder->donors, &cur->donor_elem);
+      donate_priority (cur);
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  if (lock->class != NULL) 
+    {
+      lock->acquire_time = timer_ns ();
+      lockstat_acquired (lock->class, contended, lock->acquire_time - start);
+    }
+
+  /* Threads still waiting for LOCK now donate to us. */
+  if (!thread_mlfqs && !list_empty (&lock->semaphore.waiters)) 
+    {
+      for (e = list_begin (&lock->semaphore.waiters);
+           e != list_end (&lock->semaphore.waiters); e = list_next (e))
+        {
+          struct thread *t = list_entry (e, struct thread, elem);
+          t->waiting_lock = lock;
+          list_push_back (&cur->donors, &t->donor_elem);
+        }
+      thread_refresh_priority (cur);
+    }
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -209,18 +325,34 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  /* Take the semaphore and become the holder atomically, so that
+     lock_acquire() never sees a taken lock with no holder to
+     donate to. */
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
-  if (success)
-    lock->holder = thread_current ();
+  if (success) 
+    {
+      lock->holder = thread_current ();
+      if (lock->class != NULL) 
+        {
+          lock->acquire_time = timer_ns ();
+          lockstat_acquired (lock->class, false, 0);
+        }
+    }
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Priority donated by threads waiting for LOCK is given up, and
+   if that leaves a ready thread with a higher priority than
+   ours, we yield to it.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,11 +360,33 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  struct list_elem *e, *next;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  if (!thread_mlfqs) 
+    {
+      for (e = list_begin (&cur->donors); e != list_end (&cur->donors);
+           e = next)
+        {
+          next = list_next (e);
+          if (list_entry (e, struct thread, donor_elem)->waiting_lock == lock)
+            list_remove (e);
+        }
+      thread_refresh_priority (cur);
+    }
+
+  if (lock->class != NULL)
+    lockstat_released (lock->class, timer_ns () - lock->acquire_time);
   lock->holder = NULL;
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -251,8 +405,12 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on semaphore. */
   };
 
+static bool waiter_priority_less (const struct list_elem *,
+                                  const struct list_elem *, void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -295,6 +453,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -302,8 +461,9 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
-   LOCK must be held before calling this function.
+   this function signals the highest-priority one of them to wake
+   up from its wait.  LOCK must be held before calling this
+   function.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to signal a condition variable within an
@@ -317,8 +477,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      waiter_priority_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -336,3 +500,334 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes RW as a readers-writer lock.  Any number of
+   readers may hold RW at once, or a single writer.
+
+   The lock prefers writers: once a writer is waiting, new
+   readers wait too, so that a stream of readers cannot starve
+   writers.  When the lock is released, it is handed directly to
+   the next writer if there is one, otherwise to every waiting
+   reader, so that a woken thread never has to compete for it
+   again.  Readers that find no writer holding or waiting for
+   the lock take it without sleeping and without touching any
+   list.
+
+   Unlike struct lock, RW does not donate priority. */
+void
+rwlock_init (struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  rw->readers = 0;
+  rw->writer = NULL;
+  list_init (&rw->read_waiters);
+  list_init (&rw->write_waiters);
+}
+
+/* Acquires RW for reading, sleeping until it is available if
+   necessary.  The current thread must not already hold RW for
+   writing.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != thread_current ());
+
+  old_level = intr_disable ();
+  if (rw->writer == NULL && list_empty (&rw->write_waiters))
+    rw->readers++;
+  else
+    {
+      /* rwlock_release_write() counts us as a reader before
+         waking us up. */
+      list_push_back (&rw->read_waiters, &thread_current ()->elem);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->readers > 0);
+
+  old_level = intr_disable ();
+  if (--rw->readers == 0 && !list_empty (&rw->write_waiters))
+    {
+      struct thread *t = list_entry (list_pop_front (&rw->write_waiters),
+                                     struct thread, elem);
+      rw->writer = t;
+      thread_unblock (t);
+    }
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+}
+
+/* Acquires RW for writing, sleeping until it is available if
+   necessary.  The current thread must not already hold RW.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (rw->writer != cur);
+
+  old_level = intr_disable ();
+  if (rw->writer == NULL && rw->readers == 0)
+    rw->writer = cur;
+  else
+    {
+      /* The releasing thread makes us the writer before waking
+         us up. */
+      list_push_back (&rw->write_waiters, &cur->elem);
+      thread_block ();
+      ASSERT (rw->writer == cur);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw) 
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  if (!list_empty (&rw->write_waiters))
+    {
+      struct thread *t = list_entry (list_pop_front (&rw->write_waiters),
+                                     struct thread, elem);
+      rw->writer = t;
+      thread_unblock (t);
+    }
+  else 
+    {
+      rw->writer = NULL;
+      while (!list_empty (&rw->read_waiters))
+        {
+          struct thread *t = list_entry (list_pop_front (&rw->read_waiters),
+                                         struct thread, elem);
+          rw->readers++;
+          thread_unblock (t);
+        }
+    }
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise.  (There is no way to tell whether the current
+   thread is one of RW's readers.) */
+bool
+rwlock_held_for_write (const struct rwlock *rw) 
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Initializes SL as a sequence lock, which protects data that is
+   read much more often than it is written, such as a counter
+   updated by an interrupt handler.
+
+   Readers never block writers, or each other: a reader notes the
+   sequence number with seqlock_read_begin(), reads the data, and
+   then calls seqlock_read_retry() to find out whether a write
+   happened meanwhile, in which case it must read again.  Writers
+   make the sequence number odd for the duration of a write.
+
+   Writers run with interrupts off, which serializes them and
+   ensures that a reader in an interrupt handler never waits for
+   a write it interrupted. */
+void
+seqlock_init (struct seqlock *sl) 
+{
+  ASSERT (sl != NULL);
+
+  sl->sequence = 0;
+}
+
+/* Begins a read of the data protected by SL and returns the value
+   to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *sl) 
+{
+  unsigned start;
+
+  for (;;)
+    {
+      start = *(volatile const unsigned *) &sl->sequence;
+      barrier ();
+      if ((start & 1) == 0)
+        return start;
+    }
+}
+
+/* Returns true if the data protected by SL may have changed since
+   the seqlock_read_begin() call that returned START, in which
+   case the caller must discard what it read and try again. */
+bool
+seqlock_read_retry (const struct seqlock *sl, unsigned start) 
+{
+  barrier ();
+  return *(volatile const unsigned *) &sl->sequence != start;
+}
+
+/* Begins a write of the data protected by SL.  Disables
+   interrupts and returns the previous interrupt level, which the
+   caller must pass to seqlock_write_end(). */
+enum intr_level
+seqlock_write_begin (struct seqlock *sl) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  sl->sequence++;
+  barrier ();
+  return old_level;
+}
+
+/* Ends a write of the data protected by SL and restores the
+   interrupt level to OLD_LEVEL. */
+void
+seqlock_write_end (struct seqlock *sl, enum intr_level old_level) 
+{
+  ASSERT (sl->sequence & 1);
+
+  barrier ();
+  sl->sequence++;
+  intr_set_level (old_level);
+}
+
+/* Initializes C as a completion, an event that happens once and
+   that any number of threads may wait for.  A thread that waits
+   after the event happened returns at once. */
+void
+completion_init (struct completion *c) 
+{
+  ASSERT (c != NULL);
+
+  c->done = false;
+  list_init (&c->waiters);
+}
+
+/* Waits for C to be completed.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+completion_wait (struct completion *c) 
+{
+  enum intr_level old_level;
+
+  ASSERT (c != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  if (!c->done) 
+    {
+      list_push_back (&c->waiters, &thread_current ()->elem);
+      thread_block ();
+    }
+  intr_set_level (old_level);
+}
+
+/* Completes C, waking up every thread waiting for it.  C must not
+   already be complete.
+
+   This function may be called from an interrupt handler. */
+void
+complete (struct completion *c) 
+{
+  enum intr_level old_level;
+
+  ASSERT (c != NULL);
+
+  old_level = intr_disable ();
+  ASSERT (!c->done);
+  c->done = true;
+  while (!list_empty (&c->waiters))
+    thread_unblock (list_entry (list_pop_front (&c->waiters),
+                                struct thread, elem));
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+}
+
+/* Returns true if C has been completed, false otherwise. */
+bool
+completion_done (const struct completion *c) 
+{
+  ASSERT (c != NULL);
+
+  return c->done;
+}
+
+/* Returns true if the thread owning list element A, a member of
+   a semaphore's waiters list, has lower priority than the one
+   owning B. */
+static bool
+priority_less (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->priority
+          < list_entry (b, struct thread, elem)->priority);
+}
+
+/* Returns true if the thread waiting in struct semaphore_elem A,
+   a member of a condition variable's waiters list, has lower
+   priority than the one waiting in B. */
+static bool
+waiter_priority_less (const struct list_elem *a, const struct list_elem *b,
+                      void *aux UNUSED) 
+{
+  return (list_entry (a, struct semaphore_elem, elem)->thread->priority
+          < list_entry (b, struct semaphore_elem, elem)->thread->priority);
+}
+
+/* Initializes SEMA to VALUE, with lock statistics in CLASS if it
+   is nonnull. */
+static void
+init_semaphore (struct semaphore *sema, unsigned value,
+                struct lock_class *class) 
+{
+  ASSERT (sema != NULL);
+
+  sema->value = value;
+  list_init (&sema->waiters);
+  sema->class = class;
+}
+
+/* Initializes LOCK, with lock statistics in CLASS if it is
+   nonnull.  The statistics are kept for LOCK as a whole, not
+   for its semaphore. */
+static void
+init_lock (struct lock *lock, struct lock_class *class) 
+{
+  ASSERT (lock != NULL);
+
+  lock->holder = NULL;
+  init_semaphore (&lock->semaphore, 1, NULL);
+  lock->class = class;
+}
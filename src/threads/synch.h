@@ -3,12 +3,15 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+    struct lock_class *class;   /* Lock statistics, or null. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -22,9 +25,12 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct lock_class *class;   /* Lock statistics, or null. */
+    int64_t acquire_time;       /* When acquired, if CLASS is nonnull. */
   };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -41,6 +47,46 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock 
+  {
+    unsigned readers;           /* Number of readers holding lock. */
+    struct thread *writer;      /* Writer holding lock, if any. */
+    struct list read_waiters;   /* Readers waiting for the lock. */
+    struct list write_waiters;  /* Writers waiting for the lock. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+/* Sequence lock. */
+struct seqlock 
+  {
+    unsigned sequence;          /* Odd while a write is in progress. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+enum intr_level seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *, enum intr_level);
+
+/* One-shot completion. */
+struct completion 
+  {
+    bool done;                  /* Has the event happened? */
+    struct list waiters;        /* List of waiting threads. */
+  };
+
+void completion_init (struct completion *);
+void completion_wait (struct completion *);
+void complete (struct completion *);
+bool completion_done (const struct completion *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -1,16 +1,22 @@
 #include "threads/thread.h"
 #include <debug.h>
+#include <inttypes.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
+#include "threads/fpu.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/sched-trace.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -20,9 +26,25 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Ready queues, one per priority level.  ready_lists[P] holds
+   the processes in THREAD_READY state, that is, processes that
+   are ready to run but not actually running, whose priority is
+   P, in the order they became ready.
+
+   Bit P of ready_mask is set if and only if ready_lists[P] is
+   nonempty, so that the highest-priority ready thread can be
+   found with a single bit scan instead of a search.
+
+   Ready real-time threads wait instead in rt_list, in order of
+   deadline, and run ahead of all the threads in ready_lists. */
+static struct list ready_lists[PRI_MAX + 1];
+static uint64_t ready_mask;
+static struct list rt_list;
+static int ready_cnt;           /* Number of threads in both. */
+
+#if PRI_MAX >= 64
+#error ready_mask requires PRI_MAX < 64
+#endif
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -34,8 +56,14 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of threads that have exited, kept for reuse by
+   thread_create() so that spawning a short-lived thread does
+   not have to go through palloc each time.  Protected by
+   disabling interrupts, because pages are freed into the cache
+   by thread_schedule_tail(), which runs with interrupts off. */
+#define THREAD_CACHE_SIZE 8
+static struct thread *thread_cache[THREAD_CACHE_SIZE];
+static size_t thread_cache_cnt;
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
@@ -54,29 +82,110 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Real-time scheduling class.
+
+   A real-time thread reserves a budget of CPU time in every
+   period, and each of its jobs, the work it does in one period,
+   has a deadline relative to the start of the period.  Ready
+   real-time threads run ahead of all other threads, earliest
+   deadline first (EDF).
+
+   A thread that uses up its budget before its period ends is
+   throttled, that is, blocked until the next period starts, when
+   its budget is replenished.  The budget is checked at each
+   timer tick, so a thread may overrun it by up to a tick.
+
+   Admission control keeps the total of budget / min (deadline,
+   period) over all real-time threads at or below RT_UTIL_MAX /
+   RT_UTIL_SCALE, which EDF can always schedule, and which
+   leaves the rest of the CPU to other threads. */
+#define RT_UTIL_SCALE 1000      /* Utilization of a whole CPU. */
+#define RT_UTIL_MAX 900         /* Utilization available to admit. */
+static int rt_util_total;       /* Utilization admitted so far. */
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler.
+
+   The 4.4BSD scheduler recomputes every thread's priority every
+   4 ticks and decays every thread's recent_cpu once a second.
+   Doing that literally walks all_list from the timer interrupt,
+   so the interrupt's latency grows with the number of threads,
+   most of which are typically blocked.  Instead:
+
+     - Between once-a-second decays, only threads that were
+       charged a tick have a new recent_cpu, so every 4 ticks we
+       recompute the priorities of just those threads, of which
+       there are at most MLFQS_PRIORITY_TICKS.
+
+     - Once a second, we decay the running thread and the
+       threads in the ready queues, since their priorities
+       determine who runs next.  Blocked threads are not touched:
+       the decay coefficient for each second is saved in
+       decay_history[], and a blocked thread applies the
+       coefficients it missed when it is unblocked.
+
+     - Blocked threads wait on decay_list in order of the last
+       second they were decayed.  Each tick, a few of those that
+       are in danger of falling out of decay_history[] are caught
+       up early, so the work done by any single tick stays
+       bounded no matter how many threads are blocked. */
+#define MLFQS_PRIORITY_TICKS 4  /* Ticks between priority updates. */
+#define DECAY_HISTORY 64        /* Seconds of decay coefficients kept. */
+#define DECAY_SWEEP_CNT 8       /* Blocked threads caught up per tick. */
+
+static fixed_point load_avg;    /* System load average. */
+static unsigned decay_epoch;    /* Number of decays, i.e. seconds. */
+static fixed_point decay_history[DECAY_HISTORY];
+static struct list decay_list;  /* Blocked threads, oldest decay first. */
+
+/* Threads charged a tick since the last priority update. */
+static struct thread *charged[MLFQS_PRIORITY_TICKS];
+static int charged_cnt;
+
+/* Largest number of threads updated by a single timer tick. */
+static int mlfqs_max_tick_work;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
+static void ready_push (struct thread *);
+static struct thread *ready_pop (void);
+static void ready_remove (struct thread *);
+static bool ready_preempts (struct thread *);
+static bool deadline_less (const struct list_elem *, const struct list_elem *,
+                           void *aux);
+static void rt_replenish (struct thread *, int64_t now);
+static void rt_tick (struct thread *);
+static void rt_release_func (struct hrtimer *);
+static void charge_running (struct thread *, int64_t now);
+static void change_priority (struct thread *, int priority);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_block (struct thread *);
+static void mlfqs_unblock (struct thread *);
+static void mlfqs_update_priority (struct thread *);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
+static void account_switch (struct thread *cur, struct thread *next);
+static thread_action_func print_thread_stats;
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *alloc_thread (void);
+static void free_thread (struct thread *);
 
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the ready queues.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -87,11 +196,15 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int pri;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (pri = PRI_MIN; pri <= PRI_MAX; pri++)
+    list_init (&ready_lists[pri]);
+  list_init (&rt_list);
   list_init (&all_list);
+  list_init (&decay_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -134,8 +247,14 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
+  /* Enforce preemption.  Real-time threads are not time-sliced,
+     but held to their budgets instead. */
+  if (t->rt_period != 0)
+    rt_tick (t);
+  else if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
@@ -143,8 +262,50 @@ thread_tick (void)
 void
 thread_print_stats (void) 
 {
+  enum intr_level old_level;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+  if (thread_mlfqs)
+    printf ("Thread: at most %d threads updated by one timer tick\n",
+            mlfqs_max_tick_work);
+  old_level = intr_disable ();
+  thread_foreach (print_thread_stats, NULL);
+  intr_set_level (old_level);
+  if (sched_trace_dump)
+    sched_trace_print ();
+}
+
+/* Prints T's CPU accounting.  An action for thread_foreach(). */
+static void
+print_thread_stats (struct thread *t, void *aux UNUSED) 
+{
+  int64_t run_ns = t->run_ns;
+  int64_t wait_ns = t->wait_ns;
+
+  if (t->status == THREAD_RUNNING)
+    run_ns += timer_ns () - t->stamp;
+  else if (t->status == THREAD_READY)
+    wait_ns += timer_ns () - t->stamp;
+  printf ("Thread: %s (tid %d): %"PRId64" us running, %"PRId64" us ready, "
+          "%u voluntary and %u involuntary switches\n",
+          t->name, t->tid, run_ns / 1000, wait_ns / 1000,
+          t->vol_switches, t->invol_switches);
+  if (t->rt_period != 0)
+    printf ("Thread: %s (tid %d): real-time, %u jobs, %u deadline misses, "
+            "throttled %u times\n",
+            t->name, t->tid, t->rt_jobs, t->rt_misses, t->rt_throttles);
+}
+
+/* Returns the number of timer ticks spent in the idle thread
+   since boot. */
+int64_t
+thread_get_idle_ticks (void) 
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t t = idle_ticks;
+  intr_set_level (old_level);
+  return t;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -159,9 +320,12 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, it preempts the running thread before this function
+   returns.  Under the multi-level feedback queue scheduler,
+   PRIORITY is ignored: the new thread inherits its parent's
+   niceness and recent_cpu and its priority is computed from
+   those. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -175,7 +339,7 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread ();
   if (t == NULL)
     return TID_ERROR;
 
@@ -213,10 +377,14 @@ thread_create (const char *name, int priority,
 void
 thread_block (void) 
 {
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  if (thread_mlfqs && cur != idle_thread)
+    mlfqs_block (cur);
+  cur->status = THREAD_BLOCKED;
   schedule ();
 }
 
@@ -224,10 +392,15 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   If T has a higher priority than the running thread, the
+   running thread is preempted, but only if that can be done
+   without breaking the caller's atomicity: immediately if
+   interrupts were on, or on return from the interrupt if called
+   from an external interrupt handler.  If the caller had
+   disabled interrupts itself, it may expect that it can
+   atomically unblock a thread and update other data, so the
+   running thread keeps the CPU; such a caller should invoke
+   thread_yield_to_higher() after re-enabling interrupts. */
 void
 thread_unblock (struct thread *t) 
 {
@@ -237,9 +410,23 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  if (thread_mlfqs)
+    mlfqs_unblock (t);
+  if (t->rt_period != 0) 
+    {
+      /* A thread that slept through the start of a period gets
+         the new period's budget and deadline. */
+      int64_t now = timer_ns ();
+      t->rt_throttled = false;
+      if (now >= t->rt_release)
+        rt_replenish (t, now);
+    }
+  ready_push (t);
   t->status = THREAD_READY;
+  t->stamp = timer_ns ();
   intr_set_level (old_level);
+
+  thread_yield_to_higher ();
 }
 
 /* Returns the name of the running thread. */
@@ -285,11 +472,22 @@ thread_exit (void)
 #ifdef USERPROG
   process_exit ();
 #endif
+  fpu_exit (thread_current ());
+  malloc_thread_exit ();
 
   /* Remove thread from all threads list, set our status to dying,
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (thread_mlfqs)
+    {
+      /* Make sure the next priority update does not touch us. */
+      int i;
+      for (i = 0; i < charged_cnt; i++)
+        if (charged[i] == thread_current ())
+          charged[i] = charged[--charged_cnt];
+    }
+  rt_util_total -= thread_current ()->rt_util;
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -307,13 +505,48 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
+  if (cur->rt_throttled)
+    {
+      /* Out of budget: rt_release_func() will unblock us. */
+      thread_block ();
+      intr_set_level (old_level);
+      return;
+    }
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if some ready thread should run ahead of the
+   running thread: a real-time thread with an earlier deadline,
+   or if the running thread is not real-time, any real-time
+   thread or a thread with a higher priority.  Within an
+   external interrupt handler, arranges to yield just before the
+   interrupt returns instead.  Does nothing if called with
+   interrupts disabled outside an interrupt handler, because the
+   caller presumably relies on not being preempted. */
+void
+thread_yield_to_higher (void) 
+{
+  struct thread *cur = running_thread ();
+  enum intr_level old_level;
+  bool preempt;
+
+  old_level = intr_disable ();
+  preempt = (ready_cnt != 0
+             && (cur == idle_thread || ready_preempts (cur)));
+  intr_set_level (old_level);
+
+  if (!preempt)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else if (old_level == INTR_ON)
+    thread_yield ();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -331,49 +564,205 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY.  The
+   thread keeps any higher priority donated to it through locks
+   it holds.  Yields the CPU if the running thread no longer has
+   the highest priority.  Ignored under the multi-level feedback
+   queue scheduler, which computes priorities itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_refresh_priority (cur);
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+}
+
+/* Recomputes T's priority as the higher of its base priority and
+   the priorities donated by the threads in its donors list,
+   moving T to the proper ready queue if it is ready.  Takes time
+   proportional to the number of donors.  Interrupts must be
+   off. */
+void
+thread_refresh_priority (struct thread *t) 
+{
+  int pri = t->base_priority;
+  struct list_elem *e;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&t->donors); e != list_end (&t->donors);
+       e = list_next (e))
+    {
+      struct thread *donor = list_entry (e, struct thread, donor_elem);
+      if (donor->priority > pri)
+        pri = donor->priority;
+    }
+  change_priority (t, pri);
 }
 
-/* Returns the current thread's priority. */
+/* Returns the current thread's priority, including donations. */
 int
 thread_get_priority (void) 
 {
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Makes the running thread a real-time thread that needs BUDGET
+   nanoseconds of CPU time in every PERIOD nanoseconds, by
+   DEADLINE nanoseconds into each period, or by the end of the
+   period if DEADLINE is 0.  Its first period starts now.  A
+   real-time thread marks the end of each job by calling
+   thread_wait_next_period().
+
+   Returns false, leaving the thread's scheduling unchanged, if
+   0 < BUDGET <= DEADLINE <= PERIOD does not hold or if admitting
+   the thread would overcommit the CPU. */
+bool
+thread_set_realtime (int64_t period, int64_t budget, int64_t deadline) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now;
+  int util;
+
+  if (deadline == 0)
+    deadline = period;
+  if (budget <= 0 || budget > deadline || deadline > period)
+    return false;
+  util = DIV_ROUND_UP (budget * RT_UTIL_SCALE, deadline);
+
+  old_level = intr_disable ();
+  if (rt_util_total - cur->rt_util + util > RT_UTIL_MAX) 
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+  rt_util_total += util - cur->rt_util;
+  now = timer_ns ();
+  charge_running (cur, now);
+  if (cur->rt_period == 0)
+    hrtimer_init (&cur->rt_timer, rt_release_func, cur);
+  cur->rt_util = util;
+  cur->rt_period = period;
+  cur->rt_budget = budget;
+  cur->rt_rel_deadline = deadline;
+  cur->rt_release = now;
+  rt_replenish (cur, now);
+  cur->rt_job_deadline = cur->rt_deadline;
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+  return true;
+}
+
+/* Returns the running thread to normal scheduling, releasing the
+   share of the CPU reserved by thread_set_realtime(). */
+void
+thread_clear_realtime (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  rt_util_total -= cur->rt_util;
+  cur->rt_util = 0;
+  cur->rt_period = 0;
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+}
+
+/* Ends the running real-time thread's current job and waits for
+   its next period to start, if it has not already.  Returns true
+   if the job met its deadline, false if it missed it. */
+bool
+thread_wait_next_period (void) 
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t now;
+  bool met;
+
+  ASSERT (cur->rt_period != 0);
+
+  old_level = intr_disable ();
+  now = timer_ns ();
+  met = now <= cur->rt_job_deadline;
+  cur->rt_jobs++;
+  if (!met)
+    cur->rt_misses++;
+  if (now < cur->rt_release)
+    {
+      cur->rt_throttled = true;
+      hrtimer_start (&cur->rt_timer, cur->rt_release);
+      thread_block ();
+    }
+  else
+    rt_replenish (cur, now);
+  cur->rt_job_deadline = cur->rt_deadline;
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
+  return met;
+}
+
+/* Sets the current thread's nice value to NICE, recomputes its
+   priority, and yields if it no longer has the highest
+   priority. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur);
+  intr_set_level (old_level);
+
+  thread_yield_to_higher ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fix_round (fix_mul_int (load_avg, 100));
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent = fix_round (fix_mul_int (thread_current ()->recent_cpu, 100));
+  intr_set_level (old_level);
+  return recent;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -398,6 +787,20 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Zero free pages for later PAL_ZERO requests, for as long
+         as nothing else wants to run.  A thread woken by an
+         interrupt preempts us in the middle of a page. */
+      intr_enable ();
+      while (ready_cnt == 0 && palloc_zero_idle ())
+        continue;
+      intr_disable ();
+      if (ready_cnt != 0)
+        continue;
+
+      /* Stop the periodic tick until the next timer deadline, if
+         tickless idle is enabled. */
+      timer_enter_idle ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -461,11 +864,26 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->donors);
   t->magic = THREAD_MAGIC;
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
+  if (thread_mlfqs)
+    {
+      /* The initial thread starts from scratch.  Others inherit
+         from their parent and, being blocked, join decay_list. */
+      struct thread *parent = running_thread ();
+      if (t != parent)
+        {
+          t->nice = parent->nice;
+          t->recent_cpu = parent->recent_cpu;
+          list_push_back (&decay_list, &t->decay_elem);
+        }
+      t->decay_epoch = decay_epoch;
+      mlfqs_update_priority (t);
+    }
   intr_set_level (old_level);
 }
 
@@ -482,18 +900,381 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Returns the index of the most significant set bit in MASK,
+   which must be nonzero.  See [IA32-v2a] "BSR". */
+static inline int
+highest_bit (uint64_t mask) 
+{
+  uint32_t hi = mask >> 32;
+  uint32_t lo = mask;
+  uint32_t bit;
+
+  ASSERT (mask != 0);
+  if (hi != 0)
+    {
+      asm ("bsrl %1, %0" : "=r" (bit) : "rm" (hi) : "cc");
+      return bit + 32;
+    }
+  asm ("bsrl %1, %0" : "=r" (bit) : "rm" (lo) : "cc");
+  return bit;
+}
+
+/* Adds T to the back of the ready queue for its priority, or if
+   T is real-time, to rt_list in deadline order. */
+static void
+ready_push (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  if (t->rt_period != 0)
+    list_insert_ordered (&rt_list, &t->elem, deadline_less, NULL);
+  else
+    {
+      list_push_back (&ready_lists[t->priority], &t->elem);
+      ready_mask |= (uint64_t) 1 << t->priority;
+    }
+  ready_cnt++;
+}
+
+/* Removes and returns the thread at the front of the
+   highest-priority nonempty ready queue, which must exist. */
+static struct thread *
+ready_pop (void) 
+{
+  int pri = highest_bit (ready_mask);
+  struct list *queue = &ready_lists[pri];
+  struct thread *t = list_entry (list_pop_front (queue), struct thread, elem);
+
+  if (list_empty (queue))
+    ready_mask &= ~((uint64_t) 1 << pri);
+  ready_cnt--;
+  return t;
+}
+
+/* Removes ready thread T from its ready queue. */
+static void
+ready_remove (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (t->rt_period == 0 && list_empty (&ready_lists[t->priority]))
+    ready_mask &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Returns true if some ready thread should run ahead of CUR,
+   the running thread, which is not the idle thread. */
+static bool
+ready_preempts (struct thread *cur) 
+{
+  if (!list_empty (&rt_list))
+    return (cur->rt_period == 0
+            || (list_entry (list_front (&rt_list),
+                            struct thread, elem)->rt_deadline
+                < cur->rt_deadline));
+  if (cur->rt_period != 0)
+    return false;
+  return ready_mask != 0 && highest_bit (ready_mask) > cur->priority;
+}
+
+/* Returns true if real-time thread A's deadline is strictly
+   earlier than B's. */
+static bool
+deadline_less (const struct list_elem *a, const struct list_elem *b,
+               void *aux UNUSED) 
+{
+  return (list_entry (a, struct thread, elem)->rt_deadline
+          < list_entry (b, struct thread, elem)->rt_deadline);
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
-   return a thread from the run queue, unless the run queue is
-   empty.  (If the running thread can continue running, then it
-   will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   return a thread from a ready queue, unless they are all empty.
+   (If the running thread can continue running, then it will be
+   in a ready queue.)  If they are all empty, return idle_thread.
+
+   The thread returned is the ready real-time thread with the
+   earliest deadline, if there is one, and otherwise the one at
+   the front of the highest-priority nonempty ready queue, so
+   threads of equal priority are scheduled round-robin. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  if (!list_empty (&rt_list))
+    {
+      ready_cnt--;
+      return list_entry (list_pop_front (&rt_list), struct thread, elem);
+    }
+  if (ready_mask == 0)
     return idle_thread;
+  return ready_pop ();
+}
+
+/* Sets T's priority to PRIORITY, moving T to the matching ready
+   queue if it is ready. */
+static void
+change_priority (struct thread *t, int priority) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (priority == t->priority)
+    return;
+  if (t->status == THREAD_READY && t != idle_thread)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    t->priority = priority;
+}
+
+/* Real-time scheduling class.  See the comment on RT_UTIL_SCALE
+   above for an overview. */
+
+/* Starts a new period for real-time thread T, which has begun by
+   time NOW: gives T a full budget and the period's deadline.  If
+   T missed the starts of whole periods, those are skipped. */
+static void
+rt_replenish (struct thread *t, int64_t now) 
+{
+  int64_t start = t->rt_release;
+
+  ASSERT (now >= start);
+
+  start += (now - start) / t->rt_period * t->rt_period;
+  t->rt_release = start + t->rt_period;
+  t->rt_deadline = start + t->rt_rel_deadline;
+  t->rt_left = t->rt_budget;
+}
+
+/* Does the real-time scheduling work for a timer tick during
+   which real-time thread T was running: charges T for its CPU
+   time, and if that uses up its budget, either starts T's next
+   period, if it has already begun, or throttles T until then. */
+static void
+rt_tick (struct thread *t) 
+{
+  int64_t now = timer_ns ();
+
+  charge_running (t, now);
+  if (t->rt_left > 0)
+    return;
+
+  if (now >= t->rt_release)
+    {
+      rt_replenish (t, now);
+      thread_yield_to_higher ();
+    }
+  else
+    {
+      t->rt_throttled = true;
+      t->rt_throttles++;
+      hrtimer_start (&t->rt_timer, t->rt_release);
+      intr_yield_on_return ();
+    }
+}
+
+/* High-resolution timer function that ends a real-time thread's
+   throttling when its next period starts.  The thread may not
+   have blocked yet, if the timer expired between rt_tick() and
+   the yield it requested. */
+static void
+rt_release_func (struct hrtimer *timer) 
+{
+  struct thread *t = timer->aux;
+
+  if (t->status == THREAD_BLOCKED)
+    thread_unblock (t);
+  else
+    {
+      t->rt_throttled = false;
+      rt_replenish (t, timer_ns ());
+    }
+}
+
+/* Multi-level feedback queue scheduler.  See the comment on
+   MLFQS_PRIORITY_TICKS above for an overview. */
+
+/* Returns T's priority as computed from its recent_cpu and
+   niceness. */
+static int
+mlfqs_priority (const struct thread *t) 
+{
+  int pri = PRI_MAX - fix_trunc (fix_div_int (t->recent_cpu, 4)) - t->nice * 2;
+  if (pri < PRI_MIN)
+    pri = PRI_MIN;
+  else if (pri > PRI_MAX)
+    pri = PRI_MAX;
+  return pri;
+}
+
+/* Recomputes T's priority, moving it to the proper ready queue if
+   it is ready. */
+static void
+mlfqs_update_priority (struct thread *t) 
+{
+  change_priority (t, mlfqs_priority (t));
+}
+
+/* Applies the once-a-second decay with coefficient COEF to T's
+   recent_cpu. */
+static void
+mlfqs_decay (struct thread *t, fixed_point coef) 
+{
+  t->recent_cpu = fix_add_int (fix_mul (coef, t->recent_cpu), t->nice);
+}
+
+/* Applies to T the decays it missed since it was last decayed.
+   Normally the sweep in mlfqs_tick() keeps every blocked thread
+   within DECAY_HISTORY seconds; if not, the oldest retained
+   coefficient stands in for the ones that were lost. */
+static void
+mlfqs_catch_up (struct thread *t) 
+{
+  while (t->decay_epoch != decay_epoch)
+    {
+      unsigned epoch = ++t->decay_epoch;
+      if (decay_epoch - epoch >= DECAY_HISTORY)
+        epoch = decay_epoch + 1;
+      mlfqs_decay (t, decay_history[epoch % DECAY_HISTORY]);
+    }
+}
+
+/* Called by thread_block() as T, the running thread, blocks. */
+static void
+mlfqs_block (struct thread *t) 
+{
+  ASSERT (t->decay_epoch == decay_epoch);
+  list_push_back (&decay_list, &t->decay_elem);
+}
+
+/* Called by thread_unblock() before T is put in a ready queue. */
+static void
+mlfqs_unblock (struct thread *t) 
+{
+  list_remove (&t->decay_elem);
+  mlfqs_catch_up (t);
+  t->priority = mlfqs_priority (t);
+}
+
+/* Updates the load average and decays the recent_cpu of the
+   running thread CUR and of every ready thread, requeuing those
+   in the priority ready queues by their new priorities.  Ready
+   real-time threads keep their places in rt_list, which is in
+   deadline order.  Returns the number of threads updated. */
+static int
+mlfqs_second (struct thread *cur) 
+{
+  struct list requeue;
+  struct list_elem *e;
+  int ready_threads = ready_cnt + (cur != idle_thread);
+  fixed_point coef;
+  int cnt = 0;
+
+  load_avg = (fix_mul (fix_frac (59, 60), load_avg)
+              + fix_frac (1, 60) * ready_threads);
+  coef = fix_div (fix_mul_int (load_avg, 2),
+                  fix_add_int (fix_mul_int (load_avg, 2), 1));
+  decay_epoch++;
+  decay_history[decay_epoch % DECAY_HISTORY] = coef;
+
+  /* Empty the ready queues in scheduling order, then refill them,
+     so that threads that end up with equal priorities keep their
+     relative order. */
+  list_init (&requeue);
+  while (ready_mask != 0)
+    list_push_back (&requeue, &ready_pop ()->elem);
+  while (!list_empty (&requeue))
+    {
+      struct thread *t = list_entry (list_pop_front (&requeue),
+                                     struct thread, elem);
+      mlfqs_decay (t, coef);
+      t->decay_epoch = decay_epoch;
+      t->priority = mlfqs_priority (t);
+      ready_push (t);
+      cnt++;
+    }
+  for (e = list_begin (&rt_list); e != list_end (&rt_list); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, elem);
+      mlfqs_decay (t, coef);
+      t->decay_epoch = decay_epoch;
+      t->priority = mlfqs_priority (t);
+      cnt++;
+    }
+
+  if (cur != idle_thread)
+    {
+      mlfqs_decay (cur, coef);
+      cur->decay_epoch = decay_epoch;
+      cur->priority = mlfqs_priority (cur);
+      cnt++;
+    }
+  return cnt;
+}
+
+/* Catches up to DECAY_SWEEP_CNT blocked threads that have gone
+   DECAY_HISTORY / 2 seconds without a decay, moving them to the
+   back of decay_list.  Returns the number of threads updated. */
+static int
+mlfqs_sweep (void) 
+{
+  int cnt;
+
+  for (cnt = 0; cnt < DECAY_SWEEP_CNT && !list_empty (&decay_list); cnt++)
+    {
+      struct thread *t = list_entry (list_front (&decay_list),
+                                     struct thread, decay_elem);
+      if (decay_epoch - t->decay_epoch < DECAY_HISTORY / 2)
+        break;
+      list_pop_front (&decay_list);
+      mlfqs_catch_up (t);
+      list_push_back (&decay_list, &t->decay_elem);
+    }
+  return cnt;
+}
+
+/* Does the multi-level feedback queue scheduler's work for a
+   timer tick during which CUR was running. */
+static void
+mlfqs_tick (struct thread *cur) 
+{
+  int64_t now = timer_ticks ();
+  int work = 0;
+  int i;
+
+  if (cur != idle_thread)
+    {
+      cur->recent_cpu = fix_add_int (cur->recent_cpu, 1);
+      for (i = 0; i < charged_cnt; i++)
+        if (charged[i] == cur)
+          break;
+      if (i == charged_cnt)
+        {
+          ASSERT (charged_cnt < MLFQS_PRIORITY_TICKS);
+          charged[charged_cnt++] = cur;
+        }
+    }
+
+  if (now % TIMER_FREQ == 0)
+    work += mlfqs_second (cur);
+  work += mlfqs_sweep ();
+
+  if (now % MLFQS_PRIORITY_TICKS == 0)
+    {
+      for (i = 0; i < charged_cnt; i++)
+        mlfqs_update_priority (charged[i]);
+      work += charged_cnt;
+      charged_cnt = 0;
+    }
+
+  if (work > mlfqs_max_tick_work)
+    mlfqs_max_tick_work = work;
+  thread_yield_to_higher ();
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -525,6 +1306,14 @@ thread_schedule_tail (struct thread *prev)
   /* Start new time slice. */
   thread_ticks = 0;
 
+  /* Trap the new thread's first FPU use, unless its FPU state is
+     still loaded. */
+  fpu_switch (cur);
+
+  /* Measure how long an interrupt that asked for this switch
+     waited for it. */
+  intr_stats_switch ();
+
 #ifdef USERPROG
   /* Activate the new address space. */
   process_activate ();
@@ -538,7 +1327,7 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      free_thread (prev);
     }
 }
 
@@ -560,24 +1349,97 @@ schedule (void)
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  account_switch (cur, next);
   if (cur != next)
     prev = switch_threads (cur, next);
   thread_schedule_tail (prev);
 }
 
-/* Returns a tid to use for a new thread. */
+/* Charges the running thread CUR for its time on the CPU and
+   NEXT, which schedule() chose to run next, for its time in the
+   ready queue, and records the decision in the scheduler trace.
+   A switch away from CUR is involuntary if CUR is still ready to
+   run, that is, if it was preempted or yielded. */
+static void
+account_switch (struct thread *cur, struct thread *next) 
+{
+  int64_t now = timer_ns ();
+
+  charge_running (cur, now);
+  if (cur != next) 
+    {
+      if (cur->status == THREAD_READY)
+        cur->invol_switches++;
+      else
+        cur->vol_switches++;
+    }
+  if (next->status == THREAD_READY)
+    next->wait_ns += now - next->stamp;
+  next->stamp = now;
+
+  sched_trace_record (cur, next, now, ready_cnt);
+}
+
+/* Charges T, the running thread, for its CPU time up to NOW,
+   against its budget too if it is real-time. */
+static void
+charge_running (struct thread *t, int64_t now) 
+{
+  t->run_ns += now - t->stamp;
+  if (t->rt_period != 0)
+    t->rt_left -= now - t->stamp;
+  t->stamp = now;
+}
+
+/* Returns a tid to use for a new thread.  Atomically fetches
+   and increments the next tid, so that no lock is needed.  See
+   [IA32-v2b] "XADD". */
 static tid_t
 allocate_tid (void) 
 {
   static tid_t next_tid = 1;
-  tid_t tid;
-
-  lock_acquire (&tid_lock);
-  tid = next_tid++;
-  lock_release (&tid_lock);
+  tid_t tid = 1;
 
+  asm volatile ("lock xaddl %0, %1" : "+r" (tid), "+m" (next_tid)
+                : : "memory");
   return tid;
 }
+
+/* Returns a page for a new thread, from the thread cache if
+   possible, otherwise from palloc.  The page is not zeroed:
+   init_thread() clears the struct thread and thread_create()
+   builds the stack frames it needs, and nothing else on the
+   stack is read before it is written.  Returns a null pointer if
+   memory is not available. */
+static struct thread *
+alloc_thread (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (thread_cache_cnt > 0)
+    t = thread_cache[--thread_cache_cnt];
+  intr_set_level (old_level);
+
+  return t != NULL ? t : palloc_get_page (0);
+}
+
+/* Frees the page of thread T, which has exited, into the thread
+   cache, or back to palloc if the cache is full.  T's magic
+   number is cleared so that stale pointers to T fail
+   is_thread(). */
+static void
+free_thread (struct thread *t) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->magic = 0;
+  if (thread_cache_cnt < THREAD_CACHE_SIZE)
+    thread_cache[thread_cache_cnt++] = t;
+  else
+    palloc_free_page (t);
+}
 
 /* Offset of `stack' member within `struct thread'.
    Used by switch.S, which can't figure it out on its own. */
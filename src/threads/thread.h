@@ -4,6 +4,9 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -24,6 +27,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness, for the multi-level feedback queue scheduler. */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice to other threads. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -76,10 +84,12 @@ typedef int tid_t;
    value, triggering the assertion. */
 /* The `elem' member has a dual purpose.  It can be an element in
    the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+   semaphore wait list (synch.c) or the timer's sleep list
+   (devices/timer.c).  It can be used these ways only because
+   they are mutually exclusive: only a thread in the ready state
+   is on the run queue, whereas only a thread in the blocked
+   state is on a semaphore wait list or sleep list, and a thread
+   blocks on only one of those at a time. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -87,15 +97,66 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Priority, including donations. */
+    int base_priority;                  /* Priority without donations. */
     struct list_elem allelem;           /* List element for all threads list. */
 
-    /* Shared between thread.c and synch.c. */
+    /* Shared between thread.c, synch.c, and devices/timer.c. */
     struct list_elem elem;              /* List element. */
 
+    /* Owned by synch.c, for priority donation. */
+    struct list donors;                 /* Threads waiting on our locks. */
+    struct list_elem donor_elem;        /* Element in a holder's donors. */
+    struct lock *waiting_lock;          /* Lock we are waiting for, if any. */
+
+    /* Owned by thread.c, for CPU accounting.  STAMP is when the
+       thread last started running or became ready, per
+       timer_ns(). */
+    int64_t run_ns;                     /* Time spent running. */
+    int64_t wait_ns;                    /* Time spent ready to run. */
+    int64_t stamp;                      /* Start of current state. */
+    unsigned vol_switches;              /* Switches away on blocking. */
+    unsigned invol_switches;            /* Preemptions and yields. */
+
+    /* Owned by thread.c, for the multi-level feedback queue
+       scheduler. */
+    int nice;                           /* Niceness. */
+    fixed_point recent_cpu;             /* Recent CPU time received. */
+    unsigned decay_epoch;               /* Second of last recent_cpu decay. */
+    struct list_elem decay_elem;        /* decay_list element, if blocked. */
+
+    /* Owned by thread.c, for the real-time scheduling class.
+       Times are per timer_ns().  A thread is real-time if
+       rt_period is nonzero. */
+    int64_t rt_period;                  /* Period, or 0 if not real-time. */
+    int64_t rt_budget;                  /* CPU time allowed per period. */
+    int64_t rt_rel_deadline;            /* Deadline, relative to release. */
+    int64_t rt_release;                 /* Start of the next period. */
+    int64_t rt_deadline;                /* Deadline the scheduler uses. */
+    int64_t rt_job_deadline;            /* Deadline of the current job. */
+    int64_t rt_left;                    /* Budget left until rt_release. */
+    int rt_util;                        /* Share of the CPU reserved. */
+    bool rt_throttled;                  /* Waiting for rt_release? */
+    struct hrtimer rt_timer;            /* Ends throttling at rt_release. */
+    unsigned rt_jobs;                   /* Jobs completed. */
+    unsigned rt_misses;                 /* Jobs that missed their deadline. */
+    unsigned rt_throttles;              /* Times the budget ran out. */
+
+    /* Owned by threads/malloc.c. */
+    struct malloc_mag mags[MALLOC_CLASS_CNT]; /* Free block magazines. */
+
+    /* Owned by threads/fpu.c. */
+    void *fpu;                          /* FPU state save area, or null. */
+    bool fpu_saved;                     /* Does fpu hold saved state? */
+
+    /* Owned by devices/timer.c. */
+    int64_t wakeup_tick;                /* Tick to wake up at, if asleep. */
+
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
+    struct process *process;            /* Process, if a user thread. */
+    struct uthread *uthread;            /* This thread, within process. */
 #endif
 
     /* Owned by thread.c. */
@@ -112,6 +173,7 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+int64_t thread_get_idle_ticks (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -125,6 +187,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_yield_to_higher (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -132,6 +195,11 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_refresh_priority (struct thread *);
+
+bool thread_set_realtime (int64_t period, int64_t budget, int64_t deadline);
+void thread_clear_realtime (void);
+bool thread_wait_next_period (void);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -0,0 +1,158 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* Number of worker threads for each system workqueue. */
+#define WORKER_CNT 2
+
+/* System workqueues and their properties. */
+static struct workqueue system_wqs[WORK_CLASS_CNT];
+static const struct 
+  {
+    const char *name;
+    int priority;
+  }
+system_wq_info[WORK_CLASS_CNT] = 
+  {
+    {"work-high", PRI_MAX - 1},
+    {"work", PRI_DEFAULT},
+    {"work-low", PRI_MIN + 1},
+  };
+
+static thread_func worker;
+
+/* Creates the system workqueues.  Must be called after
+   thread_start(). */
+void
+workqueue_init (void) 
+{
+  int i;
+
+  for (i = 0; i < WORK_CLASS_CNT; i++)
+    workqueue_create (&system_wqs[i], system_wq_info[i].name,
+                      system_wq_info[i].priority, WORKER_CNT);
+}
+
+/* Initializes WQ as a workqueue named NAME and starts WORKER_CNT
+   worker threads at PRIORITY to serve it. */
+void
+workqueue_create (struct workqueue *wq, const char *name,
+                  int priority, int worker_cnt) 
+{
+  int i;
+
+  ASSERT (wq != NULL);
+  ASSERT (name != NULL);
+  ASSERT (worker_cnt > 0);
+
+  wq->name = name;
+  list_init (&wq->items);
+  sema_init (&wq->ready, 0);
+  wq->priority = priority;
+
+  for (i = 0; i < worker_cnt; i++) 
+    {
+      char thread_name[16];
+
+      snprintf (thread_name, sizeof thread_name, "%s/%d", name, i);
+      if (thread_create (thread_name, priority, worker, wq) == TID_ERROR)
+        PANIC ("%s: cannot create worker thread", name);
+    }
+}
+
+/* Initializes W as a work item that calls FUNC, which may use
+   AUX. */
+void
+work_init (struct work *w, work_func *func, void *aux) 
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+
+  w->func = func;
+  w->aux = aux;
+  w->pending = false;
+}
+
+/* Queues W on WQ, so that one of WQ's workers calls W's
+   function.  Returns true if successful, false if W was already
+   pending.  May be called from an interrupt handler: this is
+   how an interrupt handler hands work to a thread.
+
+   W may be queued again as soon as its function starts. */
+bool
+work_queue (struct workqueue *wq, struct work *w) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool queued = !w->pending;
+
+  if (queued) 
+    {
+      w->pending = true;
+      list_push_back (&wq->items, &w->elem);
+    }
+  intr_set_level (old_level);
+
+  /* Wake a worker, which preempts us if it has higher
+     priority. */
+  if (queued)
+    sema_up (&wq->ready);
+  return queued;
+}
+
+/* Queues W on the system workqueue for CLASS.  Returns true if
+   successful, false if W was already pending. */
+bool
+work_schedule (enum work_class class, struct work *w) 
+{
+  ASSERT (class < WORK_CLASS_CNT);
+
+  return work_queue (&system_wqs[class], w);
+}
+
+/* Removes W from its workqueue if it has not started yet.
+   Returns true if W was pending, false otherwise.  Does not wait
+   for a W that is already running. */
+bool
+work_cancel (struct work *w) 
+{
+  enum intr_level old_level = intr_disable ();
+  bool pending = w->pending;
+
+  if (pending) 
+    {
+      list_remove (&w->elem);
+      w->pending = false;
+    }
+  intr_set_level (old_level);
+  return pending;
+}
+
+/* Worker thread: calls the functions of the work items queued on
+   the workqueue WQ_, one at a time, forever. */
+static void
+worker (void *wq_) 
+{
+  struct workqueue *wq = wq_;
+
+  for (;;) 
+    {
+      struct work *w = NULL;
+      enum intr_level old_level;
+
+      sema_down (&wq->ready);
+
+      /* The list may be empty if the item was canceled. */
+      old_level = intr_disable ();
+      if (!list_empty (&wq->items)) 
+        {
+          w = list_entry (list_pop_front (&wq->items), struct work, elem);
+          w->pending = false;
+        }
+      intr_set_level (old_level);
+
+      if (w != NULL)
+        w->func (w);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
+
+/* A work item: a function to be called later by a kernel worker
+   thread, where it may sleep, acquire locks, and so on. */
+struct work;
+typedef void work_func (struct work *);
+struct work 
+  {
+    struct list_elem elem;      /* Element in workqueue's list. */
+    work_func *func;            /* Function to call. */
+    void *aux;                  /* For use by FUNC. */
+    bool pending;               /* Queued but not yet started? */
+  };
+
+/* A queue of work items served, in FIFO order, by a pool of
+   worker threads that all run at the same priority. */
+struct workqueue 
+  {
+    const char *name;           /* Name, for debugging. */
+    struct list items;          /* Pending work items. */
+    struct semaphore ready;     /* Upped once per queued item. */
+    int priority;               /* Priority of worker threads. */
+  };
+
+/* System workqueues, one per priority class. */
+enum work_class 
+  {
+    WORK_HIGH,                  /* Latency-sensitive work. */
+    WORK_NORMAL,                /* Most deferred work. */
+    WORK_LOW,                   /* Background work. */
+    WORK_CLASS_CNT
+  };
+
+void workqueue_init (void);
+void workqueue_create (struct workqueue *, const char *name,
+                       int priority, int worker_cnt);
+
+void work_init (struct work *, work_func *, void *aux);
+bool work_queue (struct workqueue *, struct work *);
+bool work_schedule (enum work_class, struct work *);
+bool work_cancel (struct work *);
+
+#endif /* threads/workqueue.h */
@@ -0,0 +1,176 @@
+#include "userprog/futex.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Futexes: waiting for and waking up on a word of user memory.
+
+   User-space synchronization primitives keep their state in
+   user memory and change it with atomic instructions, entering
+   the kernel only to sleep when they must wait, or to wake up
+   threads that are sleeping.  A thread sleeps in futex_wait()
+   only if the word still holds the value it expects, which is
+   checked under futex_lock, so a wake-up that follows a change
+   to the word is never lost.
+
+   Waiters are queued by the kernel virtual address of the word,
+   so threads that map the same physical page at different user
+   addresses wait on the same queue.  Queues exist only while
+   they have waiters. */
+
+/* Threads waiting on one futex word. */
+struct futex_queue
+  {
+    struct hash_elem elem;      /* Element in futex_table. */
+    const void *key;            /* Kernel address of the word. */
+    struct list waiters;        /* List of struct futex_waiter. */
+  };
+
+/* One waiting thread. */
+struct futex_waiter
+  {
+    struct list_elem elem;      /* Element in queue's waiters. */
+    struct semaphore sema;      /* Upped to wake the thread. */
+  };
+
+static struct hash futex_table; /* Queues, by key. */
+static struct lock futex_lock;  /* Protects futex_table and its queues. */
+
+static hash_hash_func queue_hash;
+static hash_less_func queue_less;
+static uint32_t *user_word (uint32_t *uaddr);
+static struct futex_queue *find_queue (const void *key);
+
+/* Initializes the futex table. */
+void
+futex_init (void) 
+{
+  hash_init (&futex_table, queue_hash, queue_less, NULL);
+  lock_init (&futex_lock);
+}
+
+/* If the word at user address UADDR equals EXPECTED, sleeps
+   until futex_wake() is called on the same word and returns 0.
+   Otherwise, returns -1 at once, as it also does if UADDR is not
+   the address of an aligned word of mapped user memory or if
+   memory is not available. */
+int
+futex_wait (uint32_t *uaddr, uint32_t expected) 
+{
+  uint32_t *word = user_word (uaddr);
+  struct futex_queue *q;
+  struct futex_waiter w;
+
+  if (word == NULL)
+    return -1;
+
+  lock_acquire (&futex_lock);
+  if (*word != expected) 
+    {
+      lock_release (&futex_lock);
+      return -1;
+    }
+  q = find_queue (word);
+  if (q == NULL) 
+    {
+      q = malloc (sizeof *q);
+      if (q == NULL) 
+        {
+          lock_release (&futex_lock);
+          return -1;
+        }
+      q->key = word;
+      list_init (&q->waiters);
+      hash_insert (&futex_table, &q->elem);
+    }
+  sema_init (&w.sema, 0);
+  list_push_back (&q->waiters, &w.elem);
+  lock_release (&futex_lock);
+
+  sema_down (&w.sema);
+  return 0;
+}
+
+/* Wakes up to CNT threads waiting on the word at user address
+   UADDR, in the order they began waiting.  Returns the number
+   of threads woken, or -1 if UADDR is not the address of an
+   aligned word of mapped user memory. */
+int
+futex_wake (uint32_t *uaddr, int cnt) 
+{
+  uint32_t *word = user_word (uaddr);
+  struct futex_queue *q;
+  int woken = 0;
+
+  if (word == NULL)
+    return -1;
+
+  lock_acquire (&futex_lock);
+  q = find_queue (word);
+  if (q != NULL) 
+    {
+      while (woken < cnt && !list_empty (&q->waiters)) 
+        {
+          struct futex_waiter *w = list_entry (list_pop_front (&q->waiters),
+                                               struct futex_waiter, elem);
+          sema_up (&w->sema);
+          woken++;
+        }
+      if (list_empty (&q->waiters)) 
+        {
+          hash_delete (&futex_table, &q->elem);
+          free (q);
+        }
+    }
+  lock_release (&futex_lock);
+  return woken;
+}
+
+/* Returns the kernel address of the word at user address UADDR
+   in the running thread's address space, or a null pointer if
+   UADDR is not aligned or not mapped. */
+static uint32_t *
+user_word (uint32_t *uaddr) 
+{
+  uint32_t *pd = thread_current ()->pagedir;
+
+  if (pd == NULL || !is_user_vaddr (uaddr)
+      || (uintptr_t) uaddr % sizeof *uaddr != 0)
+    return NULL;
+  return pagedir_get_page (pd, uaddr);
+}
+
+/* Returns the queue for the word at kernel address KEY, or a
+   null pointer if no thread is waiting on it. */
+static struct futex_queue *
+find_queue (const void *key) 
+{
+  struct futex_queue q;
+  struct hash_elem *e;
+
+  q.key = key;
+  e = hash_find (&futex_table, &q.elem);
+  return e != NULL ? hash_entry (e, struct futex_queue, elem) : NULL;
+}
+
+/* Returns a hash value for futex queue E. */
+static unsigned
+queue_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct futex_queue *q = hash_entry (e, struct futex_queue, elem);
+  return hash_bytes (&q->key, sizeof q->key);
+}
+
+/* Returns true if futex queue A's key precedes B's. */
+static bool
+queue_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED) 
+{
+  return (hash_entry (a, struct futex_queue, elem)->key
+          < hash_entry (b, struct futex_queue, elem)->key);
+}
@@ -0,0 +1,10 @@
+#ifndef USERPROG_FUTEX_H
+#define USERPROG_FUTEX_H
+
+#include <stdint.h>
+
+void futex_init (void);
+int futex_wait (uint32_t *uaddr, uint32_t expected);
+int futex_wake (uint32_t *uaddr, int cnt);
+
+#endif /* userprog/futex.h */
@@ -34,7 +34,9 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != init_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if (*pde & PTE_PS)
+      palloc_free_multiple (pde_get_large_page (*pde), PTSPAN / PGSIZE);
+    else if (*pde & PTE_P) 
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -52,7 +54,9 @@ pagedir_destroy (uint32_t *pd)
    If PD does not have a page table for VADDR, behavior depends
    on CREATE.  If CREATE is true, then a new page table is
    created and a pointer into it is returned.  Otherwise, a null
-   pointer is returned. */
+   pointer is returned.
+   If VADDR is in a 4 MB large page, returns the address of its
+   PDE, whose flags have the same meanings as a PTE's. */
 static uint32_t *
 lookup_page (uint32_t *pd, const void *vaddr, bool create)
 {
@@ -79,6 +83,8 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
       else
         return NULL;
     }
+  if (*pde & PTE_PS)
+    return pde;
 
   /* Return the page table entry. */
   pt = pde_get_pt (*pde);
@@ -118,6 +124,35 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Adds a mapping in page directory PD from the 4 MB of user
+   virtual memory starting at UPAGE to the 4 MB large page
+   identified by kernel virtual address KPAGE, as a single PDE.
+   UPAGE and the physical address of KPAGE must be 4 MB aligned,
+   and large pages must be enabled.
+   If WRITABLE is true, the new page is read/write;
+   otherwise it is read-only.
+   Returns true if successful, false if PD already has a page
+   table or a large page for UPAGE. */
+bool
+pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage,
+                        bool writable)
+{
+  uint32_t *pde;
+
+  ASSERT ((uintptr_t) upage % PTSPAN == 0);
+  ASSERT (vtop (kpage) % PTSPAN == 0);
+  ASSERT (is_user_vaddr ((uint8_t *) upage + PTSPAN - 1));
+  ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
+  ASSERT (pd != init_page_dir);
+  ASSERT (large_pages);
+
+  pde = pd + pd_no (upage);
+  if (*pde != 0)
+    return false;
+  *pde = pde_create_large_user (kpage, writable);
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -130,16 +165,20 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
   ASSERT (is_user_vaddr (uaddr));
   
   pte = lookup_page (pd, uaddr, false);
-  if (pte != NULL && (*pte & PTE_P) != 0)
-    return pte_get_page (*pte) + pg_ofs (uaddr);
-  else
+  if (pte == NULL || (*pte & PTE_P) == 0)
     return NULL;
+  else if (*pte & PTE_PS)
+    return (uint8_t *) pde_get_large_page (*pte)
+           + ((uintptr_t) uaddr & ~PDE_LARGE_ADDR);
+  else
+    return pte_get_page (*pte) + pg_ofs (uaddr);
 }
 
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
-   UPAGE need not be mapped. */
+   UPAGE need not be mapped, but must not be in a large page; use
+   pagedir_clear_large_page() for those. */
 void
 pagedir_clear_page (uint32_t *pd, void *upage) 
 {
@@ -147,6 +186,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
 
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (is_user_vaddr (upage));
+  ASSERT ((pd[pd_no (upage)] & PTE_PS) == 0);
 
   pte = lookup_page (pd, upage, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
@@ -156,6 +196,38 @@ pagedir_clear_page (uint32_t *pd, void *upage)
     }
 }
 
+/* Removes the large page that maps the 4 MB of user virtual
+   memory starting at UPAGE from page directory PD.  Returns the
+   kernel virtual address of the large page, which the caller
+   must free, or a null pointer if UPAGE is not mapped by a large
+   page. */
+void *
+pagedir_clear_large_page (uint32_t *pd, void *upage) 
+{
+  uint32_t *pde;
+  void *kpage;
+
+  ASSERT ((uintptr_t) upage % PTSPAN == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pde = pd + pd_no (upage);
+  if ((*pde & PTE_PS) == 0)
+    return NULL;
+  kpage = pde_get_large_page (*pde);
+  *pde = 0;
+  invalidate_pagedir (pd);
+  return kpage;
+}
+
+/* Returns true if PD maps user virtual page UPAGE writable.
+   Returns false if PD contains no mapping for UPAGE. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *upage) 
+{
+  uint32_t *pte = lookup_page (pd, upage, false);
+  return pte != NULL && (*pte & PTE_P) != 0 && (*pte & PTE_W) != 0;
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD is dirty,
    that is, if the page has been modified since the PTE was
    installed.
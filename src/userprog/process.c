@@ -14,12 +14,39 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/pte.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 
+/* Distance between the tops of the user stacks of a process's
+   threads.  Each stack is one page, so the rest is an unmapped
+   gap that catches most stack overflows. */
+#define USER_STACK_SPACING (16 * PGSIZE)
+
+/* Information passed by process_thread_create() to
+   start_user_thread(). */
+struct user_thread_start
+  {
+    struct process *process;    /* Process to join. */
+    struct uthread *uthread;    /* New thread's record. */
+    void (*eip) (void);         /* User entry point. */
+    void *esp;                  /* Initial user stack pointer. */
+    struct semaphore started;   /* Upped once the above are copied. */
+  };
+
 static thread_func start_process NO_RETURN;
+static thread_func start_user_thread NO_RETURN;
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool init_process (void);
+static bool release_thread (struct process *, struct uthread *);
+static void destroy_process (struct process *);
+static void *stack_page (int slot);
+static void free_stack (struct process *, int slot);
+static bool install_page (void *upage, void *kpage, bool writable);
+static bool map_small_pages (uint8_t *upage, size_t size);
+static void unmap_pages (uint8_t *upage, size_t size);
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -59,7 +86,7 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (file_name, &if_.eip, &if_.esp) && init_process ();
 
   /* If load failed, quit. */
   palloc_free_page (file_name);
@@ -91,15 +118,26 @@ process_wait (tid_t child_tid UNUSED)
   return -1;
 }
 
-/* Free the current process's resources. */
+/* Free the current thread's resources, and if it is the last
+   thread of its process, the process's. */
 void
 process_exit (void)
 {
   struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  bool last = true;
   uint32_t *pd;
 
-  /* Destroy the current process's page directory and switch back
-     to the kernel-only page directory. */
+  if (p != NULL) 
+    {
+      last = release_thread (p, cur->uthread);
+      cur->process = NULL;
+      cur->uthread = NULL;
+    }
+
+  /* Switch back to the kernel-only page directory, and if no
+     other thread uses the current process's page directory,
+     destroy it. */
   pd = cur->pagedir;
   if (pd != NULL) 
     {
@@ -112,8 +150,12 @@ process_exit (void)
          that's been freed (and cleared). */
       cur->pagedir = NULL;
       pagedir_activate (NULL);
-      pagedir_destroy (pd);
+      if (last)
+        pagedir_destroy (pd);
     }
+
+  if (p != NULL && last)
+    destroy_process (p);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -132,6 +174,388 @@ process_activate (void)
   tss_update ();
 }
 
+/* Starts a new thread in the running thread's process.  The new
+   thread begins executing user code at START, with a user stack
+   of its own set up as if START had been called with arguments
+   FUNC and AUX and a null return address.  Returns the new
+   thread's identifier, or TID_ERROR if the thread cannot be
+   created.  The new thread may be scheduled (and may even exit)
+   before this function returns. */
+tid_t
+process_thread_create (void *start, void *func, void *aux) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct user_thread_start s;
+  struct uthread *u;
+  uint8_t *kpage = NULL;
+  uint32_t *top;
+  int slot;
+  tid_t tid;
+
+  if (p == NULL)
+    return TID_ERROR;
+  u = malloc (sizeof *u);
+  if (u == NULL)
+    return TID_ERROR;
+
+  /* Claim a stack slot and map its page. */
+  lock_acquire (&p->lock);
+  for (slot = 0; slot < PROCESS_THREAD_MAX; slot++)
+    if ((p->stack_slots & (1u << slot)) == 0)
+      break;
+  if (slot < PROCESS_THREAD_MAX)
+    kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  if (kpage == NULL || !install_page (stack_page (slot), kpage, true)) 
+    {
+      lock_release (&p->lock);
+      palloc_free_page (kpage);
+      free (u);
+      return TID_ERROR;
+    }
+  p->stack_slots |= 1u << slot;
+  p->thread_cnt++;
+  u->tid = TID_ERROR;
+  u->stack_slot = slot;
+  u->status = -1;
+  u->joining = false;
+  sema_init (&u->exited, 0);
+  list_push_back (&p->threads, &u->elem);
+  lock_release (&p->lock);
+
+  /* Push AUX, FUNC, and a null return address.  The i386 ABI
+     wants the arguments to start on a 16-byte boundary, so that
+     the compiler can align spills of SSE registers, so pad the
+     top of the stack by 8 bytes. */
+  top = (uint32_t *) (kpage + PGSIZE) - 2;
+  top[-1] = (uint32_t) aux;
+  top[-2] = (uint32_t) func;
+  top[-3] = 0;
+
+  s.process = p;
+  s.uthread = u;
+  s.eip = start;
+  s.esp = (uint8_t *) stack_page (slot) + PGSIZE - 5 * sizeof (uint32_t);
+  ASSERT (((uintptr_t) s.esp + sizeof (uint32_t)) % 16 == 0);
+  sema_init (&s.started, 0);
+  tid = thread_create (cur->name, thread_get_priority (),
+                       start_user_thread, &s);
+  if (tid == TID_ERROR) 
+    {
+      lock_acquire (&p->lock);
+      list_remove (&u->elem);
+      p->thread_cnt--;
+      p->stack_slots &= ~(1u << slot);
+      free_stack (p, slot);
+      lock_release (&p->lock);
+      free (u);
+      return TID_ERROR;
+    }
+  sema_down (&s.started);
+  return tid;
+}
+
+/* Waits for thread TID of the running thread's process to exit
+   and returns the status it passed to process_thread_exit(), or
+   -1 if it was killed.  Returns -1 immediately if TID is not
+   another thread of the same process, or if another thread is
+   already joining it.  A thread can be joined only once. */
+int
+process_thread_join (tid_t tid) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = cur->process;
+  struct uthread *u = NULL;
+  struct list_elem *e;
+  int status;
+
+  if (p == NULL)
+    return -1;
+
+  lock_acquire (&p->lock);
+  for (e = list_begin (&p->threads); e != list_end (&p->threads);
+       e = list_next (e))
+    {
+      struct uthread *v = list_entry (e, struct uthread, elem);
+      if (v->tid == tid && v != cur->uthread && !v->joining)
+        {
+          u = v;
+          u->joining = true;
+          break;
+        }
+    }
+  lock_release (&p->lock);
+  if (u == NULL)
+    return -1;
+
+  sema_down (&u->exited);
+  lock_acquire (&p->lock);
+  list_remove (&u->elem);
+  lock_release (&p->lock);
+  status = u->status;
+  free (u);
+  return status;
+}
+
+/* Terminates the running thread with the given STATUS, to be
+   returned by process_thread_join().  The rest of the process
+   keeps running until its last thread exits. */
+void
+process_thread_exit (int status) 
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->uthread != NULL)
+    cur->uthread->status = status;
+  thread_exit ();
+}
+
+/* Adds FILE to the running thread's process's descriptor table,
+   which all of the process's threads share.  Returns the new file
+   descriptor, or -1 if the table is full. */
+int
+process_fd_install (struct file *file) 
+{
+  struct process *p = thread_current ()->process;
+  int fd;
+
+  ASSERT (p != NULL);
+  ASSERT (file != NULL);
+
+  lock_acquire (&p->lock);
+  for (fd = PROCESS_FD_MIN; fd < PROCESS_FD_MAX; fd++)
+    if (p->files[fd] == NULL)
+      {
+        p->files[fd] = file;
+        break;
+      }
+  lock_release (&p->lock);
+  return fd < PROCESS_FD_MAX ? fd : -1;
+}
+
+/* Returns the file open as FD in the running thread's process,
+   or a null pointer if FD is not open. */
+struct file *
+process_fd_get (int fd) 
+{
+  struct process *p = thread_current ()->process;
+  struct file *file;
+
+  if (p == NULL || fd < PROCESS_FD_MIN || fd >= PROCESS_FD_MAX)
+    return NULL;
+  lock_acquire (&p->lock);
+  file = p->files[fd];
+  lock_release (&p->lock);
+  return file;
+}
+
+/* Closes FD in the running thread's process, if it is open. */
+void
+process_fd_close (int fd) 
+{
+  struct process *p = thread_current ()->process;
+  struct file *file;
+
+  if (p == NULL || fd < PROCESS_FD_MIN || fd >= PROCESS_FD_MAX)
+    return;
+  lock_acquire (&p->lock);
+  file = p->files[fd];
+  p->files[fd] = NULL;
+  lock_release (&p->lock);
+  file_close (file);
+}
+
+/* Maps SIZE bytes of zeroed, writable memory at user virtual
+   address ADDR in the running thread's process, for big
+   anonymous regions such as large arrays.  ADDR must be 4 MB
+   aligned and not null, SIZE is rounded up to a multiple of
+   4 MB, and the region must lie below the user stacks and not
+   overlap any mapped page.
+
+   Each 4 MB is mapped as one large page, which takes one TLB
+   entry instead of 1,024, if large pages are enabled and the
+   user pool has a free, 4 MB-aligned 4 MB block.  Otherwise it
+   is mapped with 4 kB pages.
+
+   Returns true if successful, false if the arguments are bad or
+   memory runs out.  On failure, nothing stays mapped. */
+bool
+process_map_large (void *addr, size_t size) 
+{
+  struct process *p = thread_current ()->process;
+  uint8_t *start = addr;
+  uint8_t *limit = stack_page (PROCESS_THREAD_MAX - 1);
+  uint8_t *upage;
+  bool success = true;
+
+  /* Mapping the null page would turn kernel null pointer
+     dereferences into accesses to user memory. */
+  if (p == NULL || size == 0 || start == NULL
+      || (uintptr_t) start % PTSPAN != 0 || start >= limit || size > (size_t) (limit - start))
+    return false;
+  size = ROUND_UP (size, PTSPAN);
+  if (size > (size_t) (limit - start))
+    return false;
+
+  lock_acquire (&p->lock);
+  for (upage = start; upage < start + size; upage += PGSIZE)
+    if (pagedir_get_page (p->pagedir, upage) != NULL) 
+      {
+        lock_release (&p->lock);
+        return false;
+      }
+
+  for (upage = start; success && upage < start + size; upage += PTSPAN) 
+    {
+      uint8_t *kpage = NULL;
+
+      if (large_pages)
+        kpage = palloc_get_multiple (PAL_USER | PAL_ZERO, PTSPAN / PGSIZE);
+      if (kpage != NULL
+          && !pagedir_set_large_page (p->pagedir, upage, kpage, true)) 
+        {
+          /* UPAGE has a page table, with nothing mapped in it. */
+          palloc_free_multiple (kpage, PTSPAN / PGSIZE);
+          kpage = NULL;
+        }
+      if (kpage == NULL)
+        success = map_small_pages (upage, PTSPAN);
+    }
+  if (!success)
+    unmap_pages (start, upage - start);
+  lock_release (&p->lock);
+
+  return success;
+}
+
+/* A thread function that joins the process passed in AUX's
+   struct user_thread_start and starts running user code. */
+static void
+start_user_thread (void *s_) 
+{
+  struct user_thread_start *s = s_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_;
+
+  cur->process = s->process;
+  cur->uthread = s->uthread;
+  cur->uthread->tid = cur->tid;
+  cur->pagedir = s->process->pagedir;
+  process_activate ();
+
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = s->eip;
+  if_.esp = s->esp;
+
+  /* S is on our creator's stack, which we must not touch after
+     this. */
+  sema_up (&s->started);
+
+  /* Start the thread by simulating a return from an interrupt,
+     as in start_process(). */
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Sets up the running thread, which has just loaded a user
+   program, as the first thread of a new process.  Returns true
+   if successful, false if memory is not available. */
+static bool
+init_process (void) 
+{
+  struct thread *cur = thread_current ();
+  struct process *p = malloc (sizeof *p);
+  struct uthread *u = malloc (sizeof *u);
+  int fd;
+
+  if (p == NULL || u == NULL) 
+    {
+      free (p);
+      free (u);
+      return false;
+    }
+
+  p->pagedir = cur->pagedir;
+  lock_init (&p->lock);
+  p->thread_cnt = 1;
+  p->stack_slots = 1;
+  list_init (&p->threads);
+  for (fd = 0; fd < PROCESS_FD_MAX; fd++)
+    p->files[fd] = NULL;
+
+  u->tid = cur->tid;
+  u->stack_slot = 0;
+  u->status = -1;
+  u->joining = false;
+  sema_init (&u->exited, 0);
+  list_push_back (&p->threads, &u->elem);
+
+  cur->process = p;
+  cur->uthread = u;
+  return true;
+}
+
+/* Removes the thread whose record is U from process P as it
+   exits, freeing its user stack and waking up any thread joining
+   it.  Returns true if it was P's last thread, in which case its
+   stack is left for pagedir_destroy() to free. */
+static bool
+release_thread (struct process *p, struct uthread *u) 
+{
+  bool last;
+
+  lock_acquire (&p->lock);
+  last = --p->thread_cnt == 0;
+  if (!last)
+    free_stack (p, u->stack_slot);
+  p->stack_slots &= ~(1u << u->stack_slot);
+  sema_up (&u->exited);
+  lock_release (&p->lock);
+  return last;
+}
+
+/* Frees process P, whose last thread has exited, closing its
+   open files and freeing the records of threads never joined. */
+static void
+destroy_process (struct process *p) 
+{
+  int fd;
+
+  for (fd = PROCESS_FD_MIN; fd < PROCESS_FD_MAX; fd++)
+    file_close (p->files[fd]);
+  while (!list_empty (&p->threads))
+    free (list_entry (list_pop_front (&p->threads), struct uthread, elem));
+  free (p);
+}
+
+/* Returns the user virtual address of the page in stack slot
+   SLOT.  Slot 0 is the stack set up by setup_stack(). */
+static void *
+stack_page (int slot) 
+{
+  return (uint8_t *) PHYS_BASE - slot * USER_STACK_SPACING - PGSIZE;
+}
+
+/* Unmaps and frees the stack page in slot SLOT of process P.
+   P's lock must be held. */
+static void
+free_stack (struct process *p, int slot) 
+{
+  void *upage = stack_page (slot);
+  void *kpage = pagedir_get_page (p->pagedir, upage);
+
+  ASSERT (lock_held_by_current_thread (&p->lock));
+
+  if (kpage != NULL) 
+    {
+      pagedir_clear_page (p->pagedir, upage);
+      palloc_free_page (kpage);
+    }
+}
+
 /* We load ELF binaries.  The following definitions are taken
    from the ELF specification, [ELF1], more-or-less verbatim.  */
 
@@ -318,8 +742,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
-
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
 static bool
@@ -444,6 +866,61 @@ setup_stack (void **esp)
   return success;
 }
 
+/* Maps SIZE bytes of zeroed, writable user pages starting at
+   UPAGE in the running thread's page directory.  Returns true if
+   successful, false if memory allocation fails or one of the
+   pages is already mapped. */
+static bool
+map_small_pages (uint8_t *upage, size_t size) 
+{
+  uint8_t *end = upage + size;
+
+  for (; upage < end; upage += PGSIZE) 
+    {
+      uint8_t *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+
+      if (kpage == NULL)
+        return false;
+      if (!install_page (upage, kpage, true)) 
+        {
+          palloc_free_page (kpage);
+          return false;
+        }
+    }
+  return true;
+}
+
+/* Unmaps and frees the pages, large or small, mapped in the SIZE
+   bytes starting at UPAGE in the running thread's page
+   directory.  UPAGE and SIZE must be multiples of 4 MB. */
+static void
+unmap_pages (uint8_t *upage, size_t size) 
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *end = upage + size;
+
+  for (; upage < end; upage += PTSPAN) 
+    {
+      uint8_t *kpage = pagedir_clear_large_page (pd, upage);
+      uint8_t *page;
+
+      if (kpage != NULL) 
+        {
+          palloc_free_multiple (kpage, PTSPAN / PGSIZE);
+          continue;
+        }
+      for (page = upage; page < upage + PTSPAN; page += PGSIZE) 
+        {
+          kpage = pagedir_get_page (pd, page);
+          if (kpage != NULL) 
+            {
+              pagedir_clear_page (pd, page);
+              palloc_free_page (kpage);
+            }
+        }
+    }
+}
+
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
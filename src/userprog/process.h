@@ -1,11 +1,62 @@
 #ifndef USERPROG_PROCESS_H
 #define USERPROG_PROCESS_H
 
+#include <list.h>
+#include <stdint.h>
+#include "threads/synch.h"
 #include "threads/thread.h"
 
+/* Maximum number of threads alive at once in one process. */
+#define PROCESS_THREAD_MAX 32
+
+/* Maximum number of open files per process. */
+#define PROCESS_FD_MAX 64
+
+/* Lowest file descriptor for an open file.  0 and 1 are the
+   console. */
+#define PROCESS_FD_MIN 2
+
+/* A user process: the address space and other resources shared
+   by all of the process's threads.  Each thread is a struct
+   thread of its own, scheduled independently, with its own user
+   stack; see process_thread_create().  The process is destroyed
+   when its last thread exits. */
+struct process
+  {
+    uint32_t *pagedir;          /* Page directory. */
+    struct lock lock;           /* Protects the members below. */
+    int thread_cnt;             /* Number of threads alive. */
+    uint32_t stack_slots;       /* Bit N set if stack slot N is in use. */
+    struct list threads;        /* struct uthread for each thread. */
+    struct file *files[PROCESS_FD_MAX]; /* Open files, by fd. */
+  };
+
+/* A thread of a user process, as far as other threads of the
+   process are concerned.  Outlives the thread itself until it is
+   joined or the process is destroyed. */
+struct uthread
+  {
+    struct list_elem elem;      /* Element in process's threads list. */
+    tid_t tid;                  /* Thread identifier. */
+    int stack_slot;             /* User stack slot. */
+    int status;                 /* Exit status. */
+    bool joining;               /* Is a thread waiting to join it? */
+    struct semaphore exited;    /* Upped when the thread exits. */
+  };
+
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
 
+tid_t process_thread_create (void *start, void *func, void *aux);
+int process_thread_join (tid_t);
+void process_thread_exit (int status) NO_RETURN;
+
+int process_fd_install (struct file *);
+struct file *process_fd_get (int fd);
+void process_fd_close (int fd);
+
+bool process_map_large (void *addr, size_t size);
+
 #endif /* userprog/process.h */
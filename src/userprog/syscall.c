@@ -1,20 +1,149 @@
 #include "userprog/syscall.h"
+#include <kmem-stat.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
+#include "threads/kmem.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/futex.h"
+#include "userprog/pagedir.h"
+#include "userprog/process.h"
 
 static void syscall_handler (struct intr_frame *);
+static bool get_user_word (const uint32_t *uaddr, uint32_t *word);
+static void get_args (const uint32_t *esp, uint32_t *args, int cnt);
+static bool put_user_buf (void *udst, const void *src, size_t size);
 
 void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  futex_init ();
 }
 
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+syscall_handler (struct intr_frame *f) 
 {
-  printf ("system call!\n");
-  thread_exit ();
+  uint32_t nr, args[3];
+
+  if (!get_user_word (f->esp, &nr))
+    thread_exit ();
+
+  switch (nr)
+    {
+    case SYS_THREAD_CREATE:
+      get_args (f->esp, args, 3);
+      f->eax = process_thread_create ((void *) args[0], (void *) args[1],
+                                      (void *) args[2]);
+      break;
+
+    case SYS_THREAD_JOIN:
+      get_args (f->esp, args, 1);
+      f->eax = process_thread_join (args[0]);
+      break;
+
+    case SYS_THREAD_EXIT:
+      get_args (f->esp, args, 1);
+      process_thread_exit (args[0]);
+
+    case SYS_FUTEX_WAIT:
+      get_args (f->esp, args, 2);
+      f->eax = futex_wait ((uint32_t *) args[0], args[1]);
+      break;
+
+    case SYS_FUTEX_WAKE:
+      get_args (f->esp, args, 2);
+      f->eax = futex_wake ((uint32_t *) args[0], args[1]);
+      break;
+
+    case SYS_INTR_STATS:
+      {
+        struct intr_stat stat;
+
+        get_args (f->esp, args, 2);
+        if (!intr_stats_get (args[0], &stat))
+          f->eax = false;
+        else if (!put_user_buf ((void *) args[1], &stat, sizeof stat))
+          thread_exit ();
+        else
+          f->eax = true;
+      }
+      break;
+
+    case SYS_KMEM_STATS:
+      {
+        struct kmem_stats stats;
+
+        get_args (f->esp, args, 1);
+        kmem_get_stats (&stats);
+        if (!put_user_buf ((void *) args[0], &stats, sizeof stats))
+          thread_exit ();
+        f->eax = true;
+      }
+      break;
+
+    case SYS_MAP_LARGE:
+      get_args (f->esp, args, 2);
+      f->eax = process_map_large ((void *) args[0], args[1]);
+      break;
+
+    default:
+      printf ("system call!\n");
+      thread_exit ();
+    }
+}
+
+/* Copies the 32-bit word at user address UADDR into *WORD.
+   Returns false, without copying, if any byte of it is not in
+   mapped user memory. */
+static bool
+get_user_word (const uint32_t *uaddr, uint32_t *word) 
+{
+  const uint8_t *first = (const uint8_t *) uaddr;
+  const uint8_t *last = first + sizeof *word - 1;
+  uint32_t *pd = thread_current ()->pagedir;
+
+  if (!is_user_vaddr (first) || !is_user_vaddr (last)
+      || pagedir_get_page (pd, first) == NULL
+      || pagedir_get_page (pd, last) == NULL)
+    return false;
+  memcpy (word, uaddr, sizeof *word);
+  return true;
+}
+
+/* Copies the CNT arguments of the system call whose user stack
+   pointer is ESP into ARGS.  Kills the calling thread if they
+   are not all in mapped user memory. */
+static void
+get_args (const uint32_t *esp, uint32_t *args, int cnt) 
+{
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    if (!get_user_word (esp + 1 + i, &args[i]))
+      thread_exit ();
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns
+   false, without copying, if any byte of UDST is not in mapped,
+   writable user memory. */
+static bool
+put_user_buf (void *udst, const void *src, size_t size) 
+{
+  uint8_t *first = udst;
+  uint8_t *last = first + size - 1;
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *page;
+
+  if (size == 0)
+    return true;
+  if (last < first || !is_user_vaddr (last))
+    return false;
+  for (page = pg_round_down (first); page <= last; page += PGSIZE)
+    if (!pagedir_is_writable (pd, page))
+      return false;
+  memcpy (udst, src, size);
+  return true;
 }